@@ -18,7 +18,7 @@
 #include <time.h>
 #include "bme680.h"
 #include "thread_pool.h"
-#include "monitor.h"
+#include "broadcast_ring.h"
 #include "pubsub.h"
 #include "logger.h"
 #include "bme680_config.h"
@@ -29,25 +29,21 @@
 #define NETLINK_USER 31
 #define GAS_THRESHOLD 100000
 
-struct bme680_sysv_msg {
-    long mtype;
-    struct bme680_fifo_data data;
-};
-
 struct task_arg {
     int num_reads;
     int dev_fd;
     int nl_sock;
-    int sysv_msgid;
     mqd_t mq;
     sem_t *sem;
-    struct bme680_monitor *monitor;
+    broadcast_ring_t *ring;  // Each sample is published once, every consumer reads it in place
+    int consumer_id;         // Gating: producer waits for it
+    int history_id;          // Lagging: skipped ahead when it falls behind
 };
 
 volatile sig_atomic_t keep_running = 1;
 struct bme680_fifo_data *shared_data;
-int shm_fd, sysv_shmid, sysv_semid, sysv_msgid;
-struct bme680_monitor data_monitor;
+int shm_fd, sysv_shmid, sysv_semid;
+broadcast_ring_t *sample_ring;
 
 void cleanup_handler(void *arg) {
     struct task_arg *targ = (struct task_arg *)arg;
@@ -66,17 +62,13 @@ void producer_task(void *arg) {
     while (keep_running && (num_reads == 0 || num_reads-- > 0)) {
         struct bme680_fifo_data fdata;
         if (ioctl(targ->dev_fd, BME680_IOC_READ_FIFO, &fdata) >= 0) {
-            bme680_monitor_write(targ->monitor, &fdata);
+            broadcast_ring_publish(targ->ring, &fdata, 1000);
             pubsub_publish("sensor_data", &fdata, sizeof(fdata));
-            logger_log(LOG_INFO, "Produced data: Temp=%.2f°C, Press=%.2fhPa, Hum=%.2f%%, Gas=%uOhms",
-                       fdata.temperature / 100.0, fdata.pressure / 100.0,
-                       fdata.humidity / 1000.0, fdata.gas_resistance);
+            LOGI("Produced data: Temp=%.2f°C, Press=%.2fhPa, Hum=%.2f%%, Gas=%uOhms",
+                 fdata.temperature / 100.0, fdata.pressure / 100.0,
+                 fdata.humidity / 1000.0, fdata.gas_resistance);
             if (mq_send(targ->mq, (char *)&fdata, sizeof(fdata), 0) < 0) {
-                logger_log(LOG_ERROR, "mq_send failed: %s", strerror(errno));
-            }
-            struct bme680_sysv_msg sysv_msg = { .mtype = 1, .data = fdata };
-            if (msgsnd(targ->sysv_msgid, &sysv_msg, sizeof(sysv_msg.data), IPC_NOWAIT) < 0) {
-                logger_log(LOG_ERROR, "System V msgsnd failed: %s", strerror(errno));
+                LOGE("mq_send failed: %s", strerror(errno));
             }
         }
         usleep(bme680_config_get_interval() * 1000);
@@ -91,11 +83,11 @@ void consumer_task(void *arg) {
     pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
     while (keep_running) {
         struct bme680_fifo_data fdata;
-        if (bme680_monitor_read(targ->monitor, &fdata)) {
+        if (broadcast_ring_poll(targ->ring, targ->consumer_id, &fdata, 1, 1000) == 1) {
             sem_wait(targ->sem);
-            logger_log(LOG_INFO, "Consumed data: Temp=%.2f°C, Press=%.2fhPa, Hum=%.2f%%, Gas=%uOhms",
-                       fdata.temperature / 100.0, fdata.pressure / 100.0,
-                       fdata.humidity / 1000.0, fdata.gas_resistance);
+            LOGI("Consumed data: Temp=%.2f°C, Press=%.2fhPa, Hum=%.2f%%, Gas=%uOhms",
+                 fdata.temperature / 100.0, fdata.pressure / 100.0,
+                 fdata.humidity / 1000.0, fdata.gas_resistance);
             sem_post(targ->sem);
         }
         pthread_testcancel();
@@ -110,11 +102,11 @@ void netlink_task(void *arg) {
     struct sockaddr_nl sa = { .nl_family = AF_NETLINK, .nl_groups = 1 };
     targ->nl_sock = socket(AF_NETLINK, SOCK_RAW, NETLINK_USER);
     if (targ->nl_sock < 0) {
-        logger_log(LOG_ERROR, "netlink socket failed: %s", strerror(errno));
+        LOGE("netlink socket failed: %s", strerror(errno));
         return;
     }
     if (bind(targ->nl_sock, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
-        logger_log(LOG_ERROR, "netlink bind failed: %s", strerror(errno));
+        LOGE("netlink bind failed: %s", strerror(errno));
         close(targ->nl_sock);
         return;
     }
@@ -123,33 +115,41 @@ void netlink_task(void *arg) {
     while (keep_running) {
         ssize_t len = recv(targ->nl_sock, buf, sizeof(buf), 0);
         if (len > 0) {
-            logger_log(LOG_INFO, "Netlink alert: %s", buf);
+            LOGI("Netlink alert: %s", buf);
         }
         pthread_testcancel();
     }
     pthread_cleanup_pop(1);
 }
 
-void sysv_msg_task(void *arg) {
+void history_task(void *arg) {
     struct task_arg *targ = (struct task_arg *)arg;
     pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
-    struct bme680_sysv_msg sysv_msg;
+    struct bme680_fifo_data batch[16];
     while (keep_running) {
-        if (msgrcv(targ->sysv_msgid, &sysv_msg, sizeof(sysv_msg.data), 1, IPC_NOWAIT) >= 0) {
-            logger_log(LOG_INFO, "System V Message: Temp=%.2f°C, Press=%.2fhPa, Hum=%.2f%%, Gas=%uOhms",
-                       sysv_msg.data.temperature / 100.0, sysv_msg.data.pressure / 100.0,
-                       sysv_msg.data.humidity / 1000.0, sysv_msg.data.gas_resistance);
+        int n = broadcast_ring_poll(targ->ring, targ->history_id, batch, 16, 1000);
+        for (int i = 0; i < n; i++) {
+            LOGI("History: Temp=%.2f°C, Press=%.2fhPa, Hum=%.2f%%, Gas=%uOhms",
+                 batch[i].temperature / 100.0, batch[i].pressure / 100.0,
+                 batch[i].humidity / 1000.0, batch[i].gas_resistance);
         }
         usleep(100000);
         pthread_testcancel();
     }
+    LOGI("History consumer missed %llu samples",
+         (unsigned long long)broadcast_ring_missed(targ->ring, targ->history_id));
 }
 
 void sensor_data_handler(void *data, size_t size) {
     struct bme680_fifo_data *fdata = (struct bme680_fifo_data *)data;
-    logger_log(LOG_INFO, "PubSub: Temp=%.2f°C, Press=%.2fhPa, Hum=%.2f%%, Gas=%uOhms",
-               fdata->temperature / 100.0, fdata->pressure / 100.0,
-               fdata->humidity / 1000.0, fdata->gas_resistance);
+    LOGI("PubSub: Temp=%.2f°C, Press=%.2fhPa, Hum=%.2f%%, Gas=%uOhms",
+         fdata->temperature / 100.0, fdata->pressure / 100.0,
+         fdata->humidity / 1000.0, fdata->gas_resistance);
+}
+
+void temp_alert_handler(void *data, size_t size) {
+    struct bme680_fifo_data *fdata = (struct bme680_fifo_data *)data;
+    LOGW("PubSub: High temperature %.2f°C", fdata->temperature / 100.0);
 }
 
 void sig_handler(int signo) {
@@ -179,40 +179,49 @@ int main(int argc, char *argv[]) {
     }
     logger_init("bme680.log");
     thread_pool_init(bme680_config_get_thread_pool_size());
-    bme680_monitor_init(&data_monitor);
+    broadcast_ring_init(&sample_ring, 64);
     pubsub_init();
-    pubsub_subscribe("sensor_data", sensor_data_handler);
+    // Logging handler writes to disk; keep it off the producer thread
+    struct pubsub_subscribe_attr sub_attr = { .async = 1, .queue_size = 32, .overflow = PUBSUB_DROP_OLD };
+    pubsub_subscribe_attr("sensor_data", sensor_data_handler, &sub_attr);
+    // Only samples above 40°C, at most one alert per minute; filtered before any copy or wakeup
+    struct pubsub_subscribe_attr alert_attr = {
+        .filter = { PUBSUB_CHANNEL(PUBSUB_FIELD_I32, struct bme680_fifo_data, temperature),
+                    .cmp = PUBSUB_CMP_GT, .lo = 4000, .min_interval_ms = 60000 }
+    };
+    pubsub_subscribe_attr("sensor_data", temp_alert_handler, &alert_attr);
 
     // Initialize IPC
     struct task_arg targ = {
         .num_reads = num_reads,
         .dev_fd = open("/dev/bme680", O_RDONLY | O_NONBLOCK),
         .nl_sock = -1,
-        .sysv_msgid = msgget(1234, IPC_CREAT | 0666),
         .mq = mq_open(MQ_NAME, O_CREAT | O_WRONLY, 0666, &(struct mq_attr){.mq_maxmsg = 10, .mq_msgsize = sizeof(struct bme680_fifo_data)}),
         .sem = sem_open(SEM_NAME, O_CREAT, 0666, 1),
-        .monitor = &data_monitor,
+        .ring = sample_ring,
+        .consumer_id = broadcast_ring_add_consumer(sample_ring, BROADCAST_GATING),
+        .history_id = broadcast_ring_add_consumer(sample_ring, BROADCAST_LAGGING),
     };
-    if (targ.dev_fd < 0 || targ.sysv_msgid < 0 || targ.mq == (mqd_t)-1 || targ.sem == SEM_FAILED) {
-        logger_log(LOG_ERROR, "Failed to initialize IPC resources");
+    if (targ.dev_fd < 0 || targ.consumer_id < 0 || targ.history_id < 0 || targ.mq == (mqd_t)-1 || targ.sem == SEM_FAILED) {
+        LOGE("Failed to initialize IPC resources");
         goto cleanup;
     }
 
     shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
     if (shm_fd < 0 || ftruncate(shm_fd, sizeof(struct bme680_fifo_data)) < 0) {
-        logger_log(LOG_ERROR, "Failed to initialize shared memory");
+        LOGE("Failed to initialize shared memory");
         goto cleanup;
     }
     shared_data = mmap(NULL, sizeof(struct bme680_fifo_data), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
     if (shared_data == MAP_FAILED) {
-        logger_log(LOG_ERROR, "mmap failed: %s", strerror(errno));
+        LOGE("mmap failed: %s", strerror(errno));
         goto cleanup;
     }
 
     sysv_shmid = shmget(1234, sizeof(struct bme680_fifo_data), IPC_CREAT | 0666);
     sysv_semid = semget(1234, 1, IPC_CREAT | 0666);
     if (sysv_shmid < 0 || sysv_semid < 0) {
-        logger_log(LOG_ERROR, "Failed to initialize System V IPC");
+        LOGE("Failed to initialize System V IPC");
         goto cleanup;
     }
 
@@ -220,7 +229,7 @@ int main(int argc, char *argv[]) {
     thread_pool_enqueue(producer_task, &targ);
     thread_pool_enqueue(consumer_task, &targ);
     thread_pool_enqueue(netlink_task, &targ);
-    thread_pool_enqueue(sysv_msg_task, &targ);
+    thread_pool_enqueue(history_task, &targ);
 
     // Handle sysfs mode
     if (use_sysfs) {
@@ -231,7 +240,7 @@ int main(int argc, char *argv[]) {
             FILE *humid_file = fopen("/sys/bus/iio/devices/iio:device0/in_humidityrelative_input", "r");
             FILE *gas_file = fopen("/sys/bus/iio/devices/iio:device0/in_resistance_input", "r");
             if (!temp_file || !press_file || !humid_file || !gas_file) {
-                logger_log(LOG_ERROR, "Failed to open sysfs files");
+                LOGE("Failed to open sysfs files");
                 if (temp_file) fclose(temp_file);
                 if (press_file) fclose(press_file);
                 if (humid_file) fclose(humid_file);
@@ -243,8 +252,8 @@ int main(int argc, char *argv[]) {
             fscanf(press_file, "%f", &press);
             fscanf(humid_file, "%f", &humid);
             fscanf(gas_file, "%f", &gas);
-            logger_log(LOG_INFO, "SysFS - Temp=%.2f°C, Press=%.2fhPa, Hum=%.2f%%, Gas=%.0fOhms",
-                       temp / 1000.0, press * 10.0, humid / 1000.0, gas);
+            LOGI("SysFS - Temp=%.2f°C, Press=%.2fhPa, Hum=%.2f%%, Gas=%.0fOhms",
+                 temp / 1000.0, press * 10.0, humid / 1000.0, gas);
             fclose(temp_file);
             fclose(press_file);
             fclose(humid_file);
@@ -262,13 +271,12 @@ cleanup:
     close(shm_fd);
     shmctl(sysv_shmid, IPC_RMID, NULL);
     semctl(sysv_semid, 0, IPC_RMID);
-    msgctl(targ.sysv_msgid, IPC_RMID, NULL);
     mq_unlink(MQ_NAME);
     sem_unlink(SEM_NAME);
-    bme680_monitor_destroy(&data_monitor);
+    broadcast_ring_destroy(sample_ring);
     pubsub_destroy();
     logger_destroy();
     bme680_config_destroy();
-    logger_log(LOG_INFO, "Application terminated normally");
+    LOGI("Application terminated normally");
     return 0;
 }
\ No newline at end of file
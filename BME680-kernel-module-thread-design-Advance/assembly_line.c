@@ -26,7 +26,7 @@ struct assembly_line {
 
 static void stage_cleanup(void *arg) {
     struct stage *s = (struct stage *)arg;
-    logger_log(LOG_INFO, "Stage cleanup: freeing stage %d", s->id);
+    LOGI("Stage cleanup: freeing stage %d", s->id);
     free(s);
 }
 
@@ -67,12 +67,12 @@ int assembly_line_init(struct assembly_line **al, int num_stages) {
         (*al)->stages[i].al = *al;
         (*al)->stages[i].running = 1;
         if (pthread_create(&(*al)->stages[i].thread, NULL, stage_thread, &(*al)->stages[i]) != 0) {
-            logger_log(LOG_ERROR, "Failed to create stage thread %d", i);
+            LOGE("Failed to create stage thread %d", i);
             assembly_line_destroy(*al);
             return -1;
         }
     }
-    logger_log(LOG_INFO, "Assembly line initialized with %d stages", num_stages);
+    LOGI("Assembly line initialized with %d stages", num_stages);
     return 0;
 }
 
@@ -81,7 +81,7 @@ void assembly_line_destroy(struct assembly_line *al) {
     clock_gettime(CLOCK_MONOTONIC, &ts);
     ts.tv_sec += 5;
     if (pthread_mutex_timedlock(&al->mutex, &ts) != 0) {
-        logger_log(LOG_ERROR, "Timed out locking for destroy");
+        LOGE("Timed out locking for destroy");
         return;
     }
     for (int i = 0; i < al->num_stages; i++) {
@@ -96,7 +96,7 @@ void assembly_line_destroy(struct assembly_line *al) {
     pthread_mutex_destroy(&al->mutex);
     free(al->stages);
     free(al);
-    logger_log(LOG_INFO, "Assembly line destroyed");
+    LOGI("Assembly line destroyed");
 }
 
 int assembly_line_process(struct assembly_line *al, struct bme680_fifo_data *data) {
@@ -13,13 +13,13 @@ struct barrier {
 
 int barrier_init(barrier_t **barrier, int total) {
     if (total <= 0) {
-        logger_log(LOG_ERROR, "Invalid barrier total: %d", total);
+        LOGE("Invalid barrier total: %d", total);
         return -EINVAL;
     }
 
     *barrier = malloc(sizeof(struct barrier));
     if (!*barrier) {
-        logger_log(LOG_ERROR, "Failed to allocate barrier");
+        LOGE("Failed to allocate barrier");
         return -ENOMEM;
     }
 
@@ -27,7 +27,7 @@ int barrier_init(barrier_t **barrier, int total) {
     pthread_cond_init(&(*barrier)->cond, NULL);
     (*barrier)->count = 0;
     (*barrier)->total = total;
-    logger_log(LOG_INFO, "Barrier initialized for %d threads", total);
+    LOGI("Barrier initialized for %d threads", total);
     return 0;
 }
 
@@ -37,12 +37,12 @@ void barrier_destroy(barrier_t *barrier) {
     pthread_mutex_destroy(&barrier->mutex);
     pthread_cond_destroy(&barrier->cond);
     free(barrier);
-    logger_log(LOG_INFO, "Barrier destroyed");
+    LOGI("Barrier destroyed");
 }
 
 int barrier_wait(barrier_t *barrier) {
     if (!barrier) {
-        logger_log(LOG_ERROR, "Invalid barrier");
+        LOGE("Invalid barrier");
         return -EINVAL;
     }
 
@@ -53,7 +53,7 @@ int barrier_wait(barrier_t *barrier) {
     } else {
         barrier->count = 0;
         pthread_cond_broadcast(&barrier->cond);
-        logger_log(LOG_DEBUG, "Barrier released for %d threads", barrier->total);
+        LOGD("Barrier released for %d threads", barrier->total);
     }
     pthread_mutex_unlock(&barrier->mutex);
     return 0;
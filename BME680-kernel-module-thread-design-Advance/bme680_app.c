@@ -51,26 +51,27 @@ static deadlock_detector_t *deadlock_detector;
 static fifo_semaphore_t *fifo_semaphore;
 static event_pair_t *event_pair;
 static int fd;
+static int sensor_topic; // pubsub id of "sensor_data"
 
 static int bme680_dev_init(const char *dev_path, uint8_t addr) {
     struct bme680_dev *dev = malloc(sizeof(struct bme680_dev));
     if (!dev) return -ENOMEM;
     dev->fd = open(dev_path, O_RDWR);
     if (dev->fd < 0) {
-        logger_log(LOG_ERROR, "Failed to open device %s: %s", dev_path, strerror(errno));
+        LOGE("Failed to open device %s: %s", dev_path, strerror(errno));
         free(dev);
         return -ENODEV;
     }
     dev->addr = addr;
     if (ioctl(dev->fd, I2C_SLAVE, addr) < 0) {
-        logger_log(LOG_ERROR, "Failed to set I2C slave address: %s", strerror(errno));
+        LOGE("Failed to set I2C slave address: %s", strerror(errno));
         close(dev->fd);
         free(dev);
         return -EIO;
     }
     // Init config
     bme680_config_init(&dev->config);
-    logger_log(LOG_INFO, "BME680 device initialized on %s addr 0x%x", dev_path, addr);
+    LOGI("BME680 device initialized on %s addr 0x%x", dev_path, addr);
     return (int)dev; // Trả về pointer cast to int nếu cần, nhưng dùng pointer
 }
 
@@ -78,7 +79,7 @@ static void bme680_dev_destroy(struct bme680_dev *dev) {
     if (dev) {
         close(dev->fd);
         free(dev);
-        logger_log(LOG_INFO, "BME680 device destroyed");
+        LOGI("BME680 device destroyed");
     }
 }
 
@@ -87,7 +88,7 @@ static int bme680_read_sensor(struct bme680_dev *dev, struct bme680_fifo_data *d
     uint8_t reg = BME680_REG_TEMP_MSB;
     uint8_t buf[8];
     if (i2c_smbus_read_i2c_block_data(dev->fd, reg, 8, buf) < 0) {
-        logger_log(LOG_ERROR, "Failed to read sensor data: %s", strerror(errno));
+        LOGE("Failed to read sensor data: %s", strerror(errno));
         return -EIO;
     }
     // Parse data (giả sử, full parse từ kernel logic)
@@ -104,13 +105,13 @@ struct bme680_app {
     struct thread_pool *tp;
     struct bme680_monitor *monitor;
     struct assembly_line *al;
-    fifo_semaphore_t *sem;
+    fifo_semaphore_t sem;
     event_pair_t *ep;
     timer_t *timer;
     fork_handler_t *fh;
     ipc_sync_t *ipc_sync;
-    rwlock_t *rwlock;
-    recursive_mutex_t *rmutex;
+    rwlock_t rwlock;
+    recursive_mutex_t rmutex;
     deadlock_detector_t *dd;
     dining_philosophers_t *dp;
     barrier_t *barrier;
@@ -120,18 +121,18 @@ struct bme680_app {
 // Cleanup handler cho app
 static void app_cleanup(void *arg) {
     struct bme680_app *app = (struct bme680_app *)arg;
-    logger_log(LOG_INFO, "App cleanup: destroying all resources");
+    LOGI("App cleanup: destroying all resources");
     fork_handler_destroy(app->fh);
     ipc_sync_destroy(app->ipc_sync);
-    rwlock_destroy(app->rwlock);
-    recursive_mutex_destroy(app->rmutex);
+    rwlock_destroy(&app->rwlock);
+    recursive_mutex_destroy(&app->rmutex);
     deadlock_detector_destroy(app->dd);
     dining_philosophers_destroy(app->dp);
     barrier_destroy(app->barrier);
     assembly_line_destroy(app->al);
     timer_destroy(app->timer);
     event_pair_destroy(app->ep);
-    fifo_semaphore_destroy(app->sem);
+    fifo_semaphore_destroy(&app->sem);
     bme680_monitor_destroy(app->monitor);
     thread_pool_destroy(app->tp);
     bme680_dev_destroy(app->dev);
@@ -141,49 +142,41 @@ static void app_cleanup(void *arg) {
 
 /* Thêm hàm signal_handler */
 static void signal_handler(int sig) {
-    logger_log(LOG_INFO, "Received signal %d, shutting down", sig);
+    LOGI("Received signal %d, shutting down", sig);
     app.running = 0;
 }
 
-static void event_loop(void)
-{
-    struct bme680_fifo_data data;
-    while (1) {
-        fifo_semaphore_wait(fifo_semaphore);
-        bme680_monitor_read(monitor, &data);
-        thread_pool_enqueue(thread_pool, process_data, &data);
-        pubsub_publish("sensor_data", &data, sizeof(data));
-    }
-}
-
+// arg là pubsub message (refcount 1) do event_loop cấp phát; format thẳng vào message mới, không copy
 static void process_data(void *arg) {
     struct bme680_fifo_data *data = (struct bme680_fifo_data *)arg;
-    char msg[128];
-    snprintf(msg, sizeof(msg), "Temp: %.2f C, Pressure: %u Pa, Humidity: %u%%, Gas: %u Ohms",
-             data->temp, data->pressure, data->humidity, data->gas_resistance);
-    pubsub_publish("sensor_data", msg, strlen(msg) + 1);
-    free(data);
+    char *msg = pubsub_msg_alloc(128);
+    if (msg) {
+        snprintf(msg, 128, "Temp: %.2f C, Pressure: %u Pa, Humidity: %u%%, Gas: %u Ohms",
+                 data->temp, data->pressure, data->humidity, data->gas_resistance);
+        pubsub_publish_msg(sensor_topic, msg);
+    }
+    pubsub_msg_unref(data);
 }
 
 static void read_sensor(void *arg) {
     struct bme680_app *app = (struct bme680_app *)arg;
     struct bme680_fifo_data data;
     if (bme680_read_sensor(app->dev, &data) == 0) {
-        if (fifo_semaphore_wait(app->sem) == 0) {
-            if (bme680_monitor_write(app->monitor, &data) == 0) {
-                event_pair_signal1(app->ep);
-            } else {
-                logger_log(LOG_ERROR, "Failed to write to monitor");
+        if (fifo_semaphore_wait(&app->sem) == 0) {
+            if (bme680_monitor_write(app->monitor, &data) != 0) {
+                LOGE("Failed to write to monitor");
             }
-            fifo_semaphore_post(app->sem);
+            fifo_semaphore_post(&app->sem);
         } else {
-            logger_log(LOG_ERROR, "Failed to acquire FIFO semaphore");
+            LOGE("Failed to acquire FIFO semaphore");
         }
     } else {
-        logger_log(LOG_ERROR, "Failed to read sensor data");
+        LOGE("Failed to read sensor data");
     }
 }
 
+#define EVENT_LOOP_BATCH 32
+
 static void *event_loop(void *arg) {
     struct bme680_app *app = (struct bme680_app *)arg;
     cpu_set_t cpuset;
@@ -193,18 +186,32 @@ static void *event_loop(void *arg) {
 
     pthread_cleanup_push(app_cleanup, app);
     while (app->running) {
-        struct bme680_fifo_data data;
-        if (bme680_monitor_read(app->monitor, &data) == 0) {
-            event_pair_wait1(app->ep);
-            if (assembly_line_process(app->al, &data) == 0) {
-                assembly_line_get_result(app->al, &data);
-                thread_pool_enqueue(app->tp, process_data, &data);
+        // Lấy cả batch mẫu trong một lần đồng bộ; timeout 1s để kiểm tra app->running
+        struct bme680_fifo_data batch[EVENT_LOOP_BATCH];
+        struct thread_pool_job jobs[EVENT_LOOP_BATCH];
+        int n = bme680_monitor_read_batch(app->monitor, batch, EVENT_LOOP_BATCH, 1, 1000);
+        if (n == -ETIMEDOUT) continue;
+        if (n < 0) {
+            LOGE("Failed to read from monitor: %d", n);
+            continue;
+        }
+        int num_jobs = 0;
+        for (int i = 0; i < n; i++) {
+            if (assembly_line_process(app->al, &batch[i]) != 0) continue;
+            assembly_line_get_result(app->al, &batch[i]);
+            struct bme680_fifo_data *copy = pubsub_msg_alloc(sizeof(*copy)); // process_data releases it
+            if (!copy) {
+                LOGE("Failed to allocate sample copy");
+                continue;
             }
-            event_pair_signal2(app->ep);
-        } else {
-            logger_log(LOG_ERROR, "Failed to read from monitor");
+            *copy = batch[i];
+            jobs[num_jobs++] = (struct thread_pool_job){ .func = process_data, .arg = copy };
+        }
+        if (num_jobs == 0) continue;
+        int queued = thread_pool_enqueue_batch_prio(app->tp, THREAD_POOL_PRIO_BACKGROUND, jobs, num_jobs);
+        for (int i = queued > 0 ? queued : 0; i < num_jobs; i++) {
+            pubsub_msg_unref(jobs[i].arg);
         }
-        usleep(100000); // Avoid busy loop
     }
     pthread_cleanup_pop(0);
     return NULL;
@@ -219,14 +226,44 @@ static void test_assembly_line(struct bme680_app *app, int num_stages, int itera
         }
         assembly_line_process(app->al, &data);
         assembly_line_get_result(app->al, &data);
-        logger_log(LOG_INFO, "Test iteration %d: Temp %.2f", i, data.temp);
+        LOGI("Test iteration %d: Temp %.2f", i, data.temp);
+    }
+}
+
+// In ra metrics của thread pool để chọn -t theo số liệu thực tế
+static void print_thread_pool_stats(struct thread_pool *tp) {
+    struct thread_pool_stats *stats = malloc(sizeof(*stats));
+    if (!stats || thread_pool_get_stats(tp, stats) != 0) {
+        free(stats);
+        return;
     }
+    printf("Thread pool: %d live threads\n", stats->live_threads);
+    printf("%-6s %-6s %10s %12s %12s %8s\n", "worker", "active", "tasks", "busy_ms", "idle_ms", "steals");
+    for (int i = 0; i < stats->num_workers; i++) {
+        struct thread_pool_worker_stats *w = &stats->workers[i];
+        if (!w->tasks && !w->active) continue;
+        printf("%-6d %-6d %10llu %12.1f %12.1f %8llu\n", w->id, w->active, (unsigned long long)w->tasks,
+               w->busy_ns / 1e6, w->idle_ns / 1e6, (unsigned long long)w->steals);
+    }
+    printf("Queue wait p50/p99: <%llu/<%llu us, run p50/p99: <%llu/<%llu us\n",
+           (unsigned long long)(thread_pool_hist_percentile_ns(stats->wait_hist, 50) / 1000),
+           (unsigned long long)(thread_pool_hist_percentile_ns(stats->wait_hist, 99) / 1000),
+           (unsigned long long)(thread_pool_hist_percentile_ns(stats->run_hist, 50) / 1000),
+           (unsigned long long)(thread_pool_hist_percentile_ns(stats->run_hist, 99) / 1000));
+    struct thread_pool_lane_stats lane[THREAD_POOL_NUM_PRIO];
+    for (int i = 0; i < THREAD_POOL_NUM_PRIO; i++) thread_pool_get_lane_stats(tp, i, &lane[i]);
+    printf("Rejected (queue full) critical/normal/background: %llu/%llu/%llu\n",
+           (unsigned long long)lane[THREAD_POOL_PRIO_CRITICAL].rejected,
+           (unsigned long long)lane[THREAD_POOL_PRIO_NORMAL].rejected,
+           (unsigned long long)lane[THREAD_POOL_PRIO_BACKGROUND].rejected);
+    free(stats);
 }
 
 int main(int argc, char *argv[]) {
     struct bme680_app app;
     int iterations = 10;
     int threads = 4;
+    int max_threads = 0;
     int num_stages = 5;
     int run_tests = 0;
 
@@ -235,6 +272,8 @@ int main(int argc, char *argv[]) {
             iterations = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
             threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            max_threads = atoi(argv[++i]); // Elastic pool: -t is the initial size, grows up to -T
         } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
             num_stages = atoi(argv[++i]);
         } else if (strcmp(argv[i], "--test") == 0) {
@@ -242,16 +281,27 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    logger_init("bme680.log");
+    // DEBUG log từ mọi primitive: ghi bất đồng bộ để không chặn hot path,
+    // xoay vòng 4 segment x 4 MiB để giới hạn dung lượng trên thẻ SD
+    struct logger_attr logger_attr = { .async = 1, .segment_size = 4 << 20, .max_segments = 4 };
+    logger_init_attr("bme680.log", &logger_attr);
     logger_set_level(LOG_DEBUG);
     pubsub_init();
-    thread_pool_init(&app.tp, threads);
-    bme680_monitor_init(&app.monitor, 100);
+    sensor_topic = pubsub_topic_id("sensor_data");
+    if (max_threads > 0) {
+        struct thread_pool_attr attr = { .mode = THREAD_POOL_SHARED_QUEUE, .min_threads = 1, .max_threads = max_threads };
+        thread_pool_init_attr(&app.tp, threads, &attr);
+    } else {
+        thread_pool_init(&app.tp, threads);
+    }
+    // Timer ghi, event_loop đọc; không bao giờ chặn read_sensor() khi consumer chậm
+    struct bme680_monitor_attr monitor_attr = { .mode = BME680_MONITOR_SPSC, .overflow = BME680_MONITOR_OVERWRITE_OLDEST };
+    bme680_monitor_init_attr(&app.monitor, 128, &monitor_attr);
     fifo_semaphore_init(&app.sem, 1);
     event_pair_init(&app.ep);
     timer_init(&app.timer, 1000, read_sensor, &app); // Read sensor every 1s
     if (assembly_line_init(&app.al, num_stages) != 0) {
-        logger_log(LOG_ERROR, "Failed to initialize assembly line");
+        LOGE("Failed to initialize assembly line");
         goto cleanup;
     }
     // Tích hợp thêm patterns để expert
@@ -265,14 +315,14 @@ int main(int argc, char *argv[]) {
 
     app.dev = (struct bme680_dev *)bme680_dev_init("/dev/i2c-1", 0x77);
     if (!app.dev) {
-        logger_log(LOG_ERROR, "Failed to initialize BME680 device");
+        LOGE("Failed to initialize BME680 device");
         goto cleanup;
     }
     app.running = 1;
 
     pthread_t event_thread;
     if (pthread_create(&event_thread, NULL, event_loop, &app) != 0) {
-        logger_log(LOG_ERROR, "Failed to create event loop thread");
+        LOGE("Failed to create event loop thread");
         goto cleanup;
     }
 
@@ -280,8 +330,19 @@ int main(int argc, char *argv[]) {
         // Run tests with valid and invalid data
         test_assembly_line(&app, num_stages, iterations, 0); // Valid data
         test_assembly_line(&app, num_stages, iterations, 1); // Invalid data
+        print_thread_pool_stats(app.tp);
     } else {
-        sleep(60); // Run for 60 seconds
+        // Chạy 60 giây; mỗi giây đọc mẫu mới nhất qua seqlock, không tiêu thụ mẫu của event loop
+        unsigned seen = 0;
+        for (int i = 0; i < 60 && app.running; i++) {
+            sleep(1);
+            struct bme680_fifo_data latest;
+            unsigned gen = bme680_monitor_latest(app.monitor, &latest);
+            if (gen == seen) continue;
+            seen = gen;
+            LOGI("Latest sample #%u: Temp %.2f C, Pressure %u Pa, Humidity %u%%", gen, latest.temp,
+                 latest.pressure, latest.humidity);
+        }
     }
 
 cleanup:
@@ -4,28 +4,37 @@
 #include <sched.h>
 #include "bme680_config.h"
 #include "logger.h"
+#include "seqlock.h"
 #include <time.h>
 struct bme680_config {
     struct bme680_dev *dev;
-    rwlock_t rwlock;
+    pthread_mutex_t lock; // Serializes sensor setting writes; readers use the seqlock snapshot
 };
-static struct bme680_config config;
+/* Oversampling snapshot: readers poll it lock-free, setters publish all three values at once */
+struct bme680_oversampling {
+    u8 temp;
+    u8 press;
+    u8 hum;
+};
+SEQLOCK_CELL(oversampling_cell, struct bme680_oversampling)
+static struct oversampling_cell oversampling;
+
 int bme680_config_init(struct bme680_config **config, struct bme680_dev *dev) {
     *config = malloc(sizeof(struct bme680_config));
     if (!*config) {
-        logger_log(LOG_ERROR, "Failed to allocate config");
+        LOGE("Failed to allocate config");
         return -ENOMEM;
     }
     (*config)->dev = dev;
-    rwlock_init(&(*config)->rwlock);
-    logger_log(LOG_INFO, "BME680 config initialized");
+    pthread_mutex_init(&(*config)->lock, NULL);
+    LOGI("BME680 config initialized");
     return 0;
 }
 
 void bme680_config_destroy(struct bme680_config *config) {
-    rwlock_destroy(&config->rwlock);
+    pthread_mutex_destroy(&config->lock);
     free(config);
-    logger_log(LOG_INFO, "BME680 config destroyed");
+    LOGI("BME680 config destroyed");
 }
 
 int bme680_config_set_temp_oversampling(struct bme680_config *config, uint8_t os) {
@@ -34,13 +43,13 @@ int bme680_config_set_temp_oversampling(struct bme680_config *config, uint8_t os
     CPU_SET(sched_getcpu() % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
     pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
 
-    rwlock_wrlock(&config->rwlock);
+    pthread_mutex_lock(&config->lock);
     int ret = bme680_set_sensor_settings(config->dev, BME680_OS_TEMP, os);
-    rwlock_unlock(&config->rwlock);
+    pthread_mutex_unlock(&config->lock);
     if (ret == 0) {
-        logger_log(LOG_DEBUG, "Temperature oversampling set to %u", os);
+        LOGD("Temperature oversampling set to %u", os);
     } else {
-        logger_log(LOG_ERROR, "Failed to set temperature oversampling: %d", ret);
+        LOGE("Failed to set temperature oversampling: %d", ret);
     }
     return ret;
 }
@@ -48,33 +57,24 @@ int bme680_config_set_temp_oversampling(struct bme680_config *config, uint8_t os
 /* Thêm hàm bme680_config_set_oversampling */
 int bme680_config_set_oversampling(u8 temp, u8 press, u8 hum)
 {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    ts.tv_sec += 5;
-
-    if (rwlock_timedwrlock(&config.rwlock, &ts) != 0) return -ETIMEDOUT;
-
-    if (temp < 0 || temp > 16 || press < 0 || press > 16 || hum < 0 || hum > 16) {
-        rwlock_unlock(&config.rwlock);
-        logger_log(LOG_ERROR, "Invalid oversampling values");
+    if (temp > 16 || press > 16 || hum > 16) {
+        LOGE("Invalid oversampling values");
         return -EINVAL;
     }
-    config.oversampling_temp = temp;
-    config.oversampling_press = press;
-    config.oversampling_hum = hum;
-    rwlock_unlock(&config.rwlock);
-    logger_log(LOG_DEBUG, "Oversampling set: temp=%u, press=%u, hum=%u", temp, press, hum);
+    struct bme680_oversampling os = { .temp = temp, .press = press, .hum = hum };
+    oversampling_cell_store(&oversampling, &os);
+    LOGD("Oversampling set: temp=%u, press=%u, hum=%u", temp, press, hum);
     return 0;
 }
 
 /* Thêm hàm bme680_config_get_oversampling */
 int bme680_config_get_oversampling(u8 *temp, u8 *press, u8 *hum)
 {
-    rwlock_rdlock(&config.rwlock);
-    *temp = config.oversampling_temp;
-    *press = config.oversampling_press;
-    *hum = config.oversampling_hum;
-    rwlock_unlock(&config.rwlock);
+    struct bme680_oversampling os;
+    oversampling_cell_load(&oversampling, &os);
+    *temp = os.temp;
+    *press = os.press;
+    *hum = os.hum;
     return 0;
 }
 
@@ -84,13 +84,13 @@ int bme680_config_set_pressure_oversampling(struct bme680_config *config, uint8_
     CPU_SET(sched_getcpu() % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
     pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
 
-    rwlock_wrlock(&config->rwlock);
+    pthread_mutex_lock(&config->lock);
     int ret = bme680_set_sensor_settings(config->dev, BME680_OS_PRESS, os);
-    rwlock_unlock(&config->rwlock);
+    pthread_mutex_unlock(&config->lock);
     if (ret == 0) {
-        logger_log(LOG_DEBUG, "Pressure oversampling set to %u", os);
+        LOGD("Pressure oversampling set to %u", os);
     } else {
-        logger_log(LOG_ERROR, "Failed to set pressure oversampling: %d", ret);
+        LOGE("Failed to set pressure oversampling: %d", ret);
     }
     return ret;
 }
@@ -101,13 +101,13 @@ int bme680_config_set_humidity_oversampling(struct bme680_config *config, uint8_
     CPU_SET(sched_getcpu() % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
     pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
 
-    rwlock_wrlock(&config->rwlock);
+    pthread_mutex_lock(&config->lock);
     int ret = bme680_set_sensor_settings(config->dev, BME680_OS_HUM, os);
-    rwlock_unlock(&config->rwlock);
+    pthread_mutex_unlock(&config->lock);
     if (ret == 0) {
-        logger_log(LOG_DEBUG, "Humidity oversampling set to %u", os);
+        LOGD("Humidity oversampling set to %u", os);
     } else {
-        logger_log(LOG_ERROR, "Failed to set humidity oversampling: %d", ret);
+        LOGE("Failed to set humidity oversampling: %d", ret);
     }
     return ret;
 }
\ No newline at end of file
@@ -2,11 +2,11 @@
 #define BME680_CONFIG_H
 
 #include "bme680.h"
-#include "rwlock.h"
+#include <pthread.h>
 #define BME680_I2C_ADDRESS_DEFAULT 0x77
 struct bme680_config {
     struct bme680_dev *dev;
-    rwlock_t rwlock;
+    pthread_mutex_t lock; // Serializes sensor setting writes; readers use the seqlock snapshot
 };
 
 int bme680_config_init(struct bme680_config **config, struct bme680_dev *dev);
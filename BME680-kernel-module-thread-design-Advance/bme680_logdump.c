@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <ctype.h>
+#include "logger_binary.h"
+
+/* Decodes a binary log (logger_attr.binary) back into the text log format: ./bme680_logdump file */
+
+static const char *level_str[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+
+struct dump_format {
+    char *fmt;
+    uint8_t nargs;
+    uint8_t types[LOGBIN_MAX_ARGS];
+};
+
+struct dump_arg {
+    int64_t i;
+    double d;
+    const char *s;
+    uint16_t slen;
+};
+
+static struct dump_format *formats;
+static size_t num_formats;
+static int64_t session_realtime_ns;
+static uint64_t session_ts_ns;
+
+static void dump_reset_formats(void) {
+    for (size_t i = 0; i < num_formats; i++) free(formats[i].fmt);
+    free(formats);
+    formats = NULL;
+    num_formats = 0;
+}
+
+static void dump_prefix(FILE *out, uint64_t ts_ns, int level) {
+    int64_t ns = session_realtime_ns + (int64_t)(ts_ns - session_ts_ns);
+    time_t sec = ns / 1000000000;
+    struct tm tm_info;
+    char timestamp[32];
+    localtime_r(&sec, &tm_info);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &tm_info);
+    fprintf(out, "[%s] [%s] ", timestamp, level >= 0 && level <= 3 ? level_str[level] : "?");
+}
+
+static int dump_define(uint32_t id, const uint8_t *p, size_t len) {
+    if (len < 1 || len < 1u + p[0] + 1 || p[0] > LOGBIN_MAX_ARGS || p[len - 1] != '\0') return -1;
+    if (id >= num_formats) {
+        struct dump_format *grown = realloc(formats, (id + 1) * sizeof(struct dump_format));
+        if (!grown) return -1;
+        memset(grown + num_formats, 0, (id + 1 - num_formats) * sizeof(struct dump_format));
+        formats = grown;
+        num_formats = id + 1;
+    }
+    struct dump_format *f = &formats[id];
+    free(f->fmt);
+    f->nargs = p[0];
+    memcpy(f->types, p + 1, f->nargs);
+    f->fmt = strdup((const char *)p + 1 + f->nargs);
+    return f->fmt ? 0 : -1;
+}
+
+/* Splits the payload into arguments; -1 if it does not match the format */
+static int dump_args(const struct dump_format *f, const uint8_t *p, size_t len, struct dump_arg *args) {
+    size_t off = 0;
+    for (int i = 0; i < f->nargs; i++) {
+        if (f->types[i] == LOGBIN_ARG_INT32) {
+            int32_t v;
+            if (off + sizeof(v) > len) return -1;
+            memcpy(&v, p + off, sizeof(v));
+            args[i].i = v;
+            off += sizeof(v);
+        } else if (f->types[i] == LOGBIN_ARG_STRING) {
+            if (off + sizeof(args[i].slen) > len) return -1;
+            memcpy(&args[i].slen, p + off, sizeof(args[i].slen));
+            off += sizeof(args[i].slen);
+            if (off + args[i].slen > len) return -1;
+            args[i].s = (const char *)p + off;
+            off += args[i].slen;
+        } else {
+            if (off + 8 > len) return -1;
+            memcpy(f->types[i] == LOGBIN_ARG_DOUBLE ? (void *)&args[i].d : (void *)&args[i].i, p + off, 8);
+            off += 8;
+        }
+    }
+    return 0;
+}
+
+/* Replays the format one conversion at a time, rewriting length modifiers to match the stored widths */
+static void dump_message(FILE *out, const struct dump_format *f, const struct dump_arg *args) {
+    int a = 0;
+    for (const char *c = f->fmt; *c; c++) {
+        if (*c != '%') {
+            fputc(*c, out);
+            continue;
+        }
+        if (c[1] == '%') {
+            fputc('%', out);
+            c++;
+            continue;
+        }
+        char spec[64];
+        int k = 0;
+        spec[k++] = '%';
+        c++;
+        while (*c && strchr("-+ #0'", *c) && k < 8) spec[k++] = *c++;
+        if (*c == '*') {
+            k += snprintf(spec + k, 16, "%d", (int)args[a++].i);
+            c++;
+        } else {
+            while (isdigit((unsigned char)*c) && k < 24) spec[k++] = *c++;
+        }
+        if (*c == '.') {
+            c++;
+            if (*c == '*') {
+                int precision = (int)args[a++].i;
+                if (precision >= 0) k += snprintf(spec + k, 16, ".%d", precision);
+                c++;
+            } else {
+                spec[k++] = '.';
+                while (isdigit((unsigned char)*c) && k < 40) spec[k++] = *c++;
+            }
+        }
+        const char *modifier = c;
+        while (*c && strchr("hljzt", *c)) c++;
+        if (!*c) break;
+        int keep_h = (c - modifier == 1 || c - modifier == 2) && modifier[0] == 'h'; // Still narrows an int
+        const struct dump_arg *arg = &args[a];
+        switch (f->types[a++]) {
+        case LOGBIN_ARG_INT32:
+            snprintf(spec + k, sizeof(spec) - k, "%.*s%c", keep_h ? (int)(c - modifier) : 0, modifier, *c);
+            fprintf(out, spec, (int)arg->i);
+            break;
+        case LOGBIN_ARG_INT64:
+            snprintf(spec + k, sizeof(spec) - k, "ll%c", *c);
+            fprintf(out, spec, (long long)arg->i);
+            break;
+        case LOGBIN_ARG_DOUBLE:
+            snprintf(spec + k, sizeof(spec) - k, "%c", *c);
+            fprintf(out, spec, arg->d);
+            break;
+        case LOGBIN_ARG_PTR:
+            snprintf(spec + k, sizeof(spec) - k, "%c", *c);
+            fprintf(out, spec, (void *)(uintptr_t)arg->i);
+            break;
+        default: {
+            char *str = strndup(arg->s, arg->slen);
+            snprintf(spec + k, sizeof(spec) - k, "%c", *c);
+            fprintf(out, spec, str ? str : "");
+            free(str);
+            break;
+        }
+        }
+    }
+    fputc('\n', out);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <binary log>\n", argv[0]);
+        return 1;
+    }
+    FILE *in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    static uint8_t payload[UINT16_MAX + 1];
+    struct logbin_hdr hdr;
+    int have_session = 0;
+    while (fread(&hdr, sizeof(hdr), 1, in) == 1) {
+        if (hdr.len && fread(payload, 1, hdr.len, in) != hdr.len) {
+            fprintf(stderr, "Truncated record at end of file\n");
+            break;
+        }
+        if (hdr.type == LOGBIN_SESSION) {
+            struct logbin_session session;
+            if (hdr.len != sizeof(session)) break;
+            memcpy(&session, payload, sizeof(session));
+            if (memcmp(session.magic, LOGBIN_MAGIC, sizeof(LOGBIN_MAGIC)) != 0) break;
+            session_realtime_ns = session.realtime_ns;
+            session_ts_ns = hdr.ts_ns;
+            dump_reset_formats();
+            have_session = 1;
+        } else if (!have_session) {
+            break;
+        } else if (hdr.type == LOGBIN_FORMAT) {
+            if (dump_define(hdr.id, payload, hdr.len) != 0) fprintf(stderr, "Bad format record %u\n", hdr.id);
+        } else if (hdr.type == LOGBIN_DROPPED) {
+            dump_prefix(stdout, hdr.ts_ns, hdr.level);
+            printf("Logger dropped %u messages\n", hdr.id);
+        } else if (hdr.type == LOGBIN_RECORD) {
+            struct dump_arg args[LOGBIN_MAX_ARGS];
+            dump_prefix(stdout, hdr.ts_ns, hdr.level);
+            if (hdr.id >= num_formats || !formats[hdr.id].fmt) {
+                printf("<unknown format %u>\n", hdr.id);
+            } else if (dump_args(&formats[hdr.id], payload, hdr.len, args) != 0) {
+                printf("<malformed record for \"%s\">\n", formats[hdr.id].fmt);
+            } else {
+                dump_message(stdout, &formats[hdr.id], args);
+            }
+        }
+    }
+    if (!have_session) fprintf(stderr, "%s is not a binary log\n", argv[1]);
+    dump_reset_formats();
+    fclose(in);
+    return have_session ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include "brlock.h"
+#include "logger.h"
+
+#define BRLOCK_TIMEOUT_MS 5000
+#define BRLOCK_DRAIN_SPINS 100 // Polls of a busy slot before the writer sleeps
+
+/*
+ * A reader bumps its slot, then checks writer; a writer sets writer, then scans the
+ * slots. Both sides use seq_cst, so either the reader sees the writer and backs out or
+ * the writer sees the reader and waits for it. The slot index is per thread, shared by
+ * every brlock, so unlock finds the slot the matching lock used.
+ */
+static atomic_int next_slot;
+static __thread int my_slot = -1;
+
+static struct brlock_slot *brlock_my_slot(brlock_t *lock) {
+    if (my_slot < 0) my_slot = atomic_fetch_add_explicit(&next_slot, 1, memory_order_relaxed) % BRLOCK_SLOTS;
+    return &lock->slots[my_slot];
+}
+
+int brlock_init(brlock_t *lock) {
+    for (int i = 0; i < BRLOCK_SLOTS; i++) atomic_init(&lock->slots[i].readers, 0);
+    atomic_init(&lock->writer, 0);
+    atomic_init(&lock->sleepers, 0);
+    atomic_init(&lock->drained, 0);
+    LOGI("Big-reader lock initialized with %d slots", BRLOCK_SLOTS);
+    return 0;
+}
+
+void brlock_destroy(brlock_t *lock) {
+    if (atomic_load(&lock->writer) != 0) LOGW("Big-reader lock destroyed while write-locked");
+    LOGI("Big-reader lock destroyed");
+}
+
+static const struct timespec *brlock_deadline(const struct timespec *deadline, struct timespec *ts) {
+    if (deadline) return deadline;
+    deadline_from_ms(ts, BRLOCK_TIMEOUT_MS);
+    return ts;
+}
+
+/* Sleeps while writer == state */
+static int brlock_wait_writer(brlock_t *lock, int state, const struct timespec *deadline) {
+    int ret = 0;
+    atomic_fetch_add(&lock->sleepers, 1);
+    if (atomic_load(&lock->writer) == state) ret = futex_wait(&lock->writer, state, deadline);
+    atomic_fetch_sub(&lock->sleepers, 1);
+    return ret == -ETIMEDOUT ? ret : 0;
+}
+
+static void brlock_release_writer(brlock_t *lock) {
+    atomic_store(&lock->writer, 0);
+    if (atomic_load(&lock->sleepers)) futex_wake(&lock->writer, INT_MAX);
+}
+
+static void brlock_reader_exit(brlock_t *lock, struct brlock_slot *slot) {
+    if (atomic_fetch_sub(&slot->readers, 1) == 1 && atomic_load(&lock->writer) == 1) {
+        atomic_fetch_add(&lock->drained, 1);
+        futex_wake(&lock->drained, 1);
+    }
+}
+
+static int brlock_read_acquire(brlock_t *lock, const struct timespec *deadline) {
+    struct brlock_slot *slot = brlock_my_slot(lock);
+    struct timespec ts;
+    for (;;) {
+        atomic_fetch_add(&slot->readers, 1);
+        int state = atomic_load(&lock->writer);
+        if (state == 0) return 0;
+        /* Back out so a draining writer can finish, then wait for it to unlock */
+        brlock_reader_exit(lock, slot);
+        deadline = brlock_deadline(deadline, &ts);
+        if (brlock_wait_writer(lock, state, deadline) != 0) {
+            LOGE("Read lock timed out");
+            return -ETIMEDOUT;
+        }
+    }
+}
+
+static int brlock_write_acquire(brlock_t *lock, const struct timespec *deadline) {
+    struct timespec ts;
+    int state = 0;
+    while (!atomic_compare_exchange_weak(&lock->writer, &state, 1)) {
+        if (state == 0) continue;
+        deadline = brlock_deadline(deadline, &ts);
+        if (brlock_wait_writer(lock, state, deadline) != 0) {
+            LOGE("Write lock timed out");
+            return -ETIMEDOUT;
+        }
+        state = 0;
+    }
+    /* New readers back off from here on; wait out the ones already inside */
+    for (int i = 0; i < BRLOCK_SLOTS; i++) {
+        int spins = 0;
+        while (atomic_load(&lock->slots[i].readers) != 0) {
+            if (spins++ < BRLOCK_DRAIN_SPINS) {
+                cpu_relax();
+                continue;
+            }
+            int word = atomic_load(&lock->drained);
+            if (atomic_load(&lock->slots[i].readers) == 0) break;
+            deadline = brlock_deadline(deadline, &ts);
+            if (futex_wait(&lock->drained, word, deadline) == -ETIMEDOUT) {
+                brlock_release_writer(lock);
+                LOGE("Write lock timed out waiting for readers");
+                return -ETIMEDOUT;
+            }
+        }
+    }
+    atomic_store(&lock->writer, 2);
+    LOGD("Big-reader write lock acquired");
+    return 0;
+}
+
+int brlock_rdlock(brlock_t *lock) {
+    return brlock_read_acquire(lock, NULL);
+}
+
+int brlock_wrlock(brlock_t *lock) {
+    return brlock_write_acquire(lock, NULL);
+}
+
+int brlock_timedrdlock(brlock_t *lock, const struct timespec *deadline) {
+    return brlock_read_acquire(lock, deadline);
+}
+
+int brlock_timedwrlock(brlock_t *lock, const struct timespec *deadline) {
+    return brlock_write_acquire(lock, deadline);
+}
+
+int brlock_unlock(brlock_t *lock) {
+    /* No reader can be inside while a writer holds it, so the caller is that writer */
+    if (atomic_load(&lock->writer) == 2) {
+        brlock_release_writer(lock);
+        LOGD("Big-reader write lock released");
+        return 0;
+    }
+    struct brlock_slot *slot = brlock_my_slot(lock);
+    if (atomic_load_explicit(&slot->readers, memory_order_relaxed) <= 0) {
+        LOGE("Attempt to unlock brlock with no active readers or writers");
+        return -EPERM;
+    }
+    brlock_reader_exit(lock, slot);
+    return 0;
+}
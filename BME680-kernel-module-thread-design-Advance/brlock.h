@@ -0,0 +1,38 @@
+#ifndef BRLOCK_H
+#define BRLOCK_H
+
+#include <stdatomic.h>
+#include <time.h>
+#include "sync_util.h"
+
+#define BRLOCK_SLOTS 64 // Reader slots; threads beyond this share them round-robin
+
+/*
+ * Big-reader lock: same surface as rwlock_t, for data read far more often than it is
+ * written (configuration, subscriber tables). Each thread counts itself in its own
+ * cache-line-sized slot, so concurrent readers share no written cache line and scale
+ * with cores. A writer announces itself, then scans every slot and waits for it to
+ * drain; writes are correspondingly expensive (~BRLOCK_SLOTS cache misses).
+ */
+struct brlock_slot {
+    _Alignas(CACHE_LINE_SIZE) atomic_int readers;
+};
+
+typedef struct brlock {
+    struct brlock_slot slots[BRLOCK_SLOTS];
+    _Alignas(CACHE_LINE_SIZE) atomic_int writer; // 0 free, 1 writer draining readers, 2 writer holds it
+    atomic_int sleepers; // Threads in futex_wait on writer
+    atomic_int drained;  // Futex word the draining writer sleeps on
+} brlock_t;
+
+int brlock_init(brlock_t *lock);
+void brlock_destroy(brlock_t *lock);
+/* 5 s timeout; a waiting writer holds off new readers */
+int brlock_rdlock(brlock_t *lock);
+int brlock_wrlock(brlock_t *lock);
+/* deadline is an absolute CLOCK_MONOTONIC time */
+int brlock_timedrdlock(brlock_t *lock, const struct timespec *deadline);
+int brlock_timedwrlock(brlock_t *lock, const struct timespec *deadline);
+int brlock_unlock(brlock_t *lock);
+
+#endif /* BRLOCK_H */
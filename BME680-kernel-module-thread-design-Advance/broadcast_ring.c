@@ -0,0 +1,272 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "broadcast_ring.h"
+#include "logger.h"
+#include "sync_util.h"
+
+#define BROADCAST_RING_SPIN 100 // Polls before parking
+
+/*
+ * Each slot is a small seqlock: the producer stores 2*seq+1 while writing sample seq and
+ * 2*seq+2 when done. A lagging reader copies the data and rechecks the stamp; if it moved,
+ * the producer lapped it mid-copy and the copy is thrown away. Gating readers can never be
+ * lapped. The unsynchronised copy is the usual seqlock race and is benign.
+ */
+struct broadcast_slot {
+    atomic_ulong stamp;
+    struct bme680_fifo_data data;
+};
+
+struct broadcast_consumer {
+    _Alignas(CACHE_LINE_SIZE) atomic_ulong next; // Next sequence to read, written by the consumer
+    atomic_int active;
+    atomic_int policy; // enum broadcast_consumer_policy; the producer may still be scanning a reused slot
+    atomic_ullong missed;
+};
+
+struct broadcast_ring {
+    struct broadcast_slot *slots;
+    unsigned long mask;
+    pthread_mutex_t mutex; // Serializes consumer registration
+    struct broadcast_consumer consumers[BROADCAST_RING_MAX_CONSUMERS];
+    _Alignas(CACHE_LINE_SIZE) atomic_ulong cursor; // Next sequence to publish
+    unsigned long gate; // Producer only: slowest gating cursor seen last time
+    _Alignas(CACHE_LINE_SIZE) atomic_int published; // Futex word for sleeping consumers
+    atomic_int reader_waiters;
+    _Alignas(CACHE_LINE_SIZE) atomic_int consumed; // Futex word for a producer blocked on gating consumers
+    atomic_int producer_waiting;
+};
+
+int broadcast_ring_init(broadcast_ring_t **ring, int size) {
+    if (size <= 0) {
+        LOGE("Invalid broadcast ring size %d", size);
+        return -EINVAL;
+    }
+    unsigned long capacity = 1;
+    while (capacity < (unsigned long)size) capacity <<= 1;
+    *ring = aligned_alloc(CACHE_LINE_SIZE, sizeof(struct broadcast_ring));
+    if (!*ring) {
+        LOGE("Failed to allocate broadcast ring");
+        return -ENOMEM;
+    }
+    memset(*ring, 0, sizeof(struct broadcast_ring));
+    size_t bytes = (capacity * sizeof(struct broadcast_slot) + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+    (*ring)->slots = aligned_alloc(CACHE_LINE_SIZE, bytes); // Size must be a multiple of the alignment
+    if (!(*ring)->slots) {
+        LOGE("Failed to allocate broadcast ring slots");
+        free(*ring);
+        return -ENOMEM;
+    }
+    for (unsigned long i = 0; i < capacity; i++) {
+        atomic_init(&(*ring)->slots[i].stamp, 0);
+    }
+    (*ring)->mask = capacity - 1;
+    pthread_mutex_init(&(*ring)->mutex, NULL);
+    for (int i = 0; i < BROADCAST_RING_MAX_CONSUMERS; i++) {
+        atomic_init(&(*ring)->consumers[i].next, 0);
+        atomic_init(&(*ring)->consumers[i].active, 0);
+        atomic_init(&(*ring)->consumers[i].policy, BROADCAST_GATING);
+        atomic_init(&(*ring)->consumers[i].missed, 0);
+    }
+    atomic_init(&(*ring)->cursor, 0);
+    atomic_init(&(*ring)->published, 0);
+    atomic_init(&(*ring)->reader_waiters, 0);
+    atomic_init(&(*ring)->consumed, 0);
+    atomic_init(&(*ring)->producer_waiting, 0);
+    LOGI("Broadcast ring initialized with size %lu", capacity);
+    return 0;
+}
+
+void broadcast_ring_destroy(broadcast_ring_t *ring) {
+    pthread_mutex_destroy(&ring->mutex);
+    free(ring->slots);
+    free(ring);
+    LOGI("Broadcast ring destroyed");
+}
+
+/* Wake sleepers on word; the fence pairs with the one taken before sleeping */
+static void broadcast_ring_notify(atomic_int *word, atomic_int *waiters) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiters, memory_order_relaxed) > 0) {
+        atomic_fetch_add(word, 1);
+        futex_wake(word, BROADCAST_RING_MAX_CONSUMERS);
+    }
+}
+
+int broadcast_ring_add_consumer(broadcast_ring_t *ring, enum broadcast_consumer_policy policy) {
+    if (policy != BROADCAST_GATING && policy != BROADCAST_LAGGING) return -EINVAL;
+    pthread_mutex_lock(&ring->mutex);
+    for (int i = 0; i < BROADCAST_RING_MAX_CONSUMERS; i++) {
+        struct broadcast_consumer *c = &ring->consumers[i];
+        if (atomic_load(&c->active)) continue;
+        atomic_store_explicit(&c->policy, policy, memory_order_relaxed);
+        atomic_store(&c->missed, 0);
+        unsigned long next = atomic_load(&ring->cursor);
+        atomic_store(&c->next, next);
+        atomic_store(&c->active, 1);
+        /* The producer ignored us until now and may have published a lap meanwhile */
+        atomic_thread_fence(memory_order_seq_cst);
+        unsigned long cursor = atomic_load(&ring->cursor);
+        if (cursor - next > ring->mask) atomic_store(&c->next, cursor - ring->mask);
+        pthread_mutex_unlock(&ring->mutex);
+        LOGI("Broadcast consumer %d added (%s)", i, policy == BROADCAST_GATING ? "gating" : "lagging");
+        return i;
+    }
+    pthread_mutex_unlock(&ring->mutex);
+    LOGE("No free broadcast consumer slot");
+    return -ENOSPC;
+}
+
+int broadcast_ring_remove_consumer(broadcast_ring_t *ring, int id) {
+    if (id < 0 || id >= BROADCAST_RING_MAX_CONSUMERS) return -EINVAL;
+    pthread_mutex_lock(&ring->mutex);
+    atomic_store(&ring->consumers[id].active, 0);
+    pthread_mutex_unlock(&ring->mutex);
+    broadcast_ring_notify(&ring->consumed, &ring->producer_waiting); // It may have been gating the producer
+    return 0;
+}
+
+/* Slowest active gating consumer, or seq itself when there is none */
+static unsigned long broadcast_ring_min_gate(broadcast_ring_t *ring, unsigned long seq) {
+    unsigned long min = seq;
+    for (int i = 0; i < BROADCAST_RING_MAX_CONSUMERS; i++) {
+        struct broadcast_consumer *c = &ring->consumers[i];
+        if (!atomic_load_explicit(&c->active, memory_order_acquire) ||
+            atomic_load_explicit(&c->policy, memory_order_relaxed) != BROADCAST_GATING)
+            continue;
+        unsigned long next = atomic_load_explicit(&c->next, memory_order_acquire);
+        if (next < min) min = next;
+    }
+    return min;
+}
+
+int broadcast_ring_publish(broadcast_ring_t *ring, const struct bme680_fifo_data *data, int timeout_ms) {
+    unsigned long seq = atomic_load_explicit(&ring->cursor, memory_order_relaxed);
+    unsigned long capacity = ring->mask + 1;
+
+    if (seq - ring->gate >= capacity) ring->gate = broadcast_ring_min_gate(ring, seq);
+    if (seq - ring->gate >= capacity) {
+        struct timespec ts;
+        int have_deadline = 0;
+        for (int spin = 0; seq - ring->gate >= capacity; spin++, ring->gate = broadcast_ring_min_gate(ring, seq)) {
+            if (timeout_ms == 0) return -ETIMEDOUT;
+            if (spin < BROADCAST_RING_SPIN) {
+                cpu_relax();
+                continue;
+            }
+            if (!have_deadline && timeout_ms > 0) {
+                deadline_from_ms(&ts, timeout_ms);
+                have_deadline = 1;
+            }
+            int word = atomic_load(&ring->consumed);
+            atomic_store(&ring->producer_waiting, 1);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (seq - broadcast_ring_min_gate(ring, seq) < capacity) {
+                atomic_store(&ring->producer_waiting, 0);
+                continue;
+            }
+            int ret = futex_wait(&ring->consumed, word, have_deadline ? &ts : NULL);
+            atomic_store(&ring->producer_waiting, 0);
+            if (ret == -ETIMEDOUT) {
+                LOGE("Broadcast publish timed out waiting for gating consumers");
+                return -ETIMEDOUT;
+            }
+        }
+    }
+
+    struct broadcast_slot *slot = &ring->slots[seq & ring->mask];
+    atomic_store_explicit(&slot->stamp, 2 * seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->data = *data;
+    atomic_store_explicit(&slot->stamp, 2 * seq + 2, memory_order_release);
+    atomic_store_explicit(&ring->cursor, seq + 1, memory_order_release);
+    broadcast_ring_notify(&ring->published, &ring->reader_waiters);
+    return 0;
+}
+
+/* Copy what is available without blocking; returns the count */
+static int broadcast_ring_try_read(broadcast_ring_t *ring, struct broadcast_consumer *c,
+                                   struct bme680_fifo_data *buf, int max) {
+    unsigned long capacity = ring->mask + 1;
+    unsigned long next = atomic_load_explicit(&c->next, memory_order_relaxed);
+    unsigned long cursor = atomic_load_explicit(&ring->cursor, memory_order_acquire);
+
+    if (cursor - next > capacity - 1 && c->policy == BROADCAST_LAGGING) {
+        /* Lapped: the slot for cursor is about to be reused, so resume just after it */
+        unsigned long oldest = cursor - capacity + 1;
+        atomic_fetch_add_explicit(&c->missed, oldest - next, memory_order_relaxed);
+        next = oldest;
+    }
+    int k = 0;
+    while (k < max && next + k < cursor) {
+        unsigned long seq = next + k;
+        struct broadcast_slot *slot = &ring->slots[seq & ring->mask];
+        unsigned long stamp = atomic_load_explicit(&slot->stamp, memory_order_acquire);
+        if (stamp != 2 * seq + 2) {
+            /*
+             * Overwritten. A lagging reader skips ahead on the next call. A gating reader can
+             * only get here if the producer overran it before it saw the consumer registered
+             * (it caches the gate); resync it the same way instead of stalling on this slot.
+             */
+            if (k == 0 && c->policy == BROADCAST_GATING) {
+                cursor = atomic_load_explicit(&ring->cursor, memory_order_acquire);
+                unsigned long oldest = cursor - capacity + 1;
+                if (oldest > next) {
+                    atomic_fetch_add_explicit(&c->missed, oldest - next, memory_order_relaxed);
+                    next = oldest;
+                }
+                continue;
+            }
+            break;
+        }
+        buf[k] = slot->data;
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->stamp, memory_order_relaxed) != stamp) break;
+        k++;
+    }
+    atomic_store_explicit(&c->next, next + k, memory_order_release);
+    return k;
+}
+
+int broadcast_ring_poll(broadcast_ring_t *ring, int id, struct bme680_fifo_data *buf, int max, int timeout_ms) {
+    if (id < 0 || id >= BROADCAST_RING_MAX_CONSUMERS || !buf || max <= 0) return -EINVAL;
+    struct broadcast_consumer *c = &ring->consumers[id];
+    if (!atomic_load(&c->active)) return -EINVAL;
+
+    struct timespec ts;
+    int have_deadline = 0;
+    for (int spin = 0;; spin++) {
+        int k = broadcast_ring_try_read(ring, c, buf, max);
+        if (k > 0) {
+            if (c->policy == BROADCAST_GATING) broadcast_ring_notify(&ring->consumed, &ring->producer_waiting);
+            return k;
+        }
+        if (timeout_ms == 0) return -ETIMEDOUT;
+        if (spin < BROADCAST_RING_SPIN) {
+            cpu_relax();
+            continue;
+        }
+        if (!have_deadline && timeout_ms > 0) {
+            deadline_from_ms(&ts, timeout_ms);
+            have_deadline = 1;
+        }
+        int word = atomic_load(&ring->published);
+        atomic_fetch_add(&ring->reader_waiters, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load(&c->next) != atomic_load(&ring->cursor)) {
+            atomic_fetch_sub(&ring->reader_waiters, 1);
+            continue;
+        }
+        int ret = futex_wait(&ring->published, word, have_deadline ? &ts : NULL);
+        atomic_fetch_sub(&ring->reader_waiters, 1);
+        if (ret == -ETIMEDOUT) return -ETIMEDOUT;
+    }
+}
+
+uint64_t broadcast_ring_missed(broadcast_ring_t *ring, int id) {
+    if (id < 0 || id >= BROADCAST_RING_MAX_CONSUMERS) return 0;
+    return atomic_load_explicit(&ring->consumers[id].missed, memory_order_relaxed);
+}
@@ -0,0 +1,34 @@
+#ifndef BROADCAST_RING_H
+#define BROADCAST_RING_H
+
+#include <stdint.h>
+#include "bme680.h"
+
+/*
+ * Single-producer broadcast ring: every sample is written once and read by every
+ * registered consumer through its own cursor.
+ */
+
+#define BROADCAST_RING_MAX_CONSUMERS 16
+
+typedef struct broadcast_ring broadcast_ring_t;
+
+enum broadcast_consumer_policy {
+    BROADCAST_GATING,  // Producer waits for this consumer; it never misses a sample
+    BROADCAST_LAGGING  // Producer never waits; if lapped, the consumer skips ahead and counts the loss
+};
+
+/* size is rounded up to a power of two */
+int broadcast_ring_init(broadcast_ring_t **ring, int size);
+void broadcast_ring_destroy(broadcast_ring_t *ring);
+/* Returns a consumer id starting at the next published sample, or -ENOSPC */
+int broadcast_ring_add_consumer(broadcast_ring_t *ring, enum broadcast_consumer_policy policy);
+int broadcast_ring_remove_consumer(broadcast_ring_t *ring, int id);
+/* Producer only; timeout_ms < 0 waits forever for gating consumers, 0 never blocks */
+int broadcast_ring_publish(broadcast_ring_t *ring, const struct bme680_fifo_data *data, int timeout_ms);
+/* Reads up to max samples for consumer id; returns the count or -ETIMEDOUT */
+int broadcast_ring_poll(broadcast_ring_t *ring, int id, struct bme680_fifo_data *buf, int max, int timeout_ms);
+/* Samples a consumer lost because it was lapped (a gating one only while being added) */
+uint64_t broadcast_ring_missed(broadcast_ring_t *ring, int id);
+
+#endif /* BROADCAST_RING_H */
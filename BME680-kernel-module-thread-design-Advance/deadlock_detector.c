@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <time.h>
+#include <unistd.h>
 #include "deadlock_detector.h"
 #include "logger.h"
 
@@ -16,25 +17,26 @@ struct deadlock_detector {
     pthread_mutex_t mutex;
 };
 
-int deadlock_detector_init(deadlock_detector_t *dd, int num_mutexes) {
-    dd = malloc(sizeof(deadlock_detector_t));
-    if (!dd) {
-        logger_log(LOG_ERROR, "Failed to allocate deadlock detector");
+int deadlock_detector_init(deadlock_detector_t **dd, int num_mutexes) {
+    *dd = malloc(sizeof(deadlock_detector_t));
+    if (!*dd) {
+        LOGE("Failed to allocate deadlock detector");
         return -ENOMEM;
     }
-    dd->locks = malloc(num_mutexes * sizeof(struct lock_info));
-    if (!dd->locks) {
-        logger_log(LOG_ERROR, "Failed to allocate lock info array");
-        free(dd);
+    (*dd)->locks = malloc(num_mutexes * sizeof(struct lock_info));
+    if (!(*dd)->locks) {
+        LOGE("Failed to allocate lock info array");
+        free(*dd);
+        *dd = NULL;
         return -ENOMEM;
     }
-    dd->num_mutexes = num_mutexes;
+    (*dd)->num_mutexes = num_mutexes;
     for (int i = 0; i < num_mutexes; i++) {
-        dd->locks[i].owner = 0;
-        dd->locks[i].locked = 0;
+        (*dd)->locks[i].owner = 0;
+        (*dd)->locks[i].locked = 0;
     }
-    pthread_mutex_init(&dd->mutex, NULL);
-    logger_log(LOG_INFO, "Deadlock detector initialized with %d mutexes", num_mutexes);
+    pthread_mutex_init(&(*dd)->mutex, NULL);
+    LOGI("Deadlock detector initialized with %d mutexes", num_mutexes);
     return 0;
 }
 
@@ -42,12 +44,12 @@ void deadlock_detector_destroy(deadlock_detector_t *dd) {
     pthread_mutex_destroy(&dd->mutex);
     free(dd->locks);
     free(dd);
-    logger_log(LOG_INFO, "Deadlock detector destroyed");
+    LOGI("Deadlock detector destroyed");
 }
 
 int deadlock_detector_lock(deadlock_detector_t *dd, int mutex_id) {
     if (mutex_id < 0 || mutex_id >= dd->num_mutexes) {
-        logger_log(LOG_ERROR, "Invalid mutex ID: %d", mutex_id);
+        LOGE("Invalid mutex ID: %d", mutex_id);
         return -EINVAL;
     }
     struct timespec ts;
@@ -59,8 +61,8 @@ int deadlock_detector_lock(deadlock_detector_t *dd, int mutex_id) {
         if (dd->locks[i].locked && dd->locks[i].owner != current) {
             for (int j = 0; j < dd->num_mutexes; j++) {
                 if (dd->locks[j].locked && dd->locks[j].owner == current && j > i) {
-                    logger_log(LOG_WARNING, "Potential deadlock detected: thread %lu holds mutex %d, wants mutex %d",
-                               (unsigned long)current, j, i);
+                    LOGW("Potential deadlock detected: thread %lu holds mutex %d, wants mutex %d",
+                         (unsigned long)current, j, i);
                     pthread_mutex_unlock(&dd->mutex);
                     usleep(10000); // Backoff
                     return -EDEADLK;
@@ -71,24 +73,24 @@ int deadlock_detector_lock(deadlock_detector_t *dd, int mutex_id) {
     dd->locks[mutex_id].owner = current;
     dd->locks[mutex_id].locked = 1;
     pthread_mutex_unlock(&dd->mutex);
-    logger_log(LOG_DEBUG, "Mutex %d locked by thread %lu", mutex_id, (unsigned long)current);
+    LOGD("Mutex %d locked by thread %lu", mutex_id, (unsigned long)current);
     return 0;
 }
 
 int deadlock_detector_unlock(deadlock_detector_t *dd, int mutex_id) {
     if (mutex_id < 0 || mutex_id >= dd->num_mutexes) {
-        logger_log(LOG_ERROR, "Invalid mutex ID: %d", mutex_id);
+        LOGE("Invalid mutex ID: %d", mutex_id);
         return -EINVAL;
     }
     pthread_mutex_lock(&dd->mutex);
     if (!dd->locks[mutex_id].locked || dd->locks[mutex_id].owner != pthread_self()) {
         pthread_mutex_unlock(&dd->mutex);
-        logger_log(LOG_ERROR, "Attempt to unlock mutex %d by non-owner thread", mutex_id);
+        LOGE("Attempt to unlock mutex %d by non-owner thread", mutex_id);
         return -EPERM;
     }
     dd->locks[mutex_id].locked = 0;
     dd->locks[mutex_id].owner = 0;
     pthread_mutex_unlock(&dd->mutex);
-    logger_log(LOG_DEBUG, "Mutex %d unlocked", mutex_id);
+    LOGD("Mutex %d unlocked", mutex_id);
     return 0;
 }
\ No newline at end of file
@@ -14,13 +14,13 @@ struct dining_philosophers {
 
 int dining_philosophers_init(dining_philosophers_t **dp, int num_philosophers) {
     if (num_philosophers <= 0) {
-        logger_log(LOG_ERROR, "Invalid number of philosophers: %d", num_philosophers);
+        LOGE("Invalid number of philosophers: %d", num_philosophers);
         return -EINVAL;
     }
 
     *dp = malloc(sizeof(struct dining_philosophers));
     if (!*dp) {
-        logger_log(LOG_ERROR, "Failed to allocate dining philosophers");
+        LOGE("Failed to allocate dining philosophers");
         return -ENOMEM;
     }
 
@@ -28,14 +28,14 @@ int dining_philosophers_init(dining_philosophers_t **dp, int num_philosophers) {
     (*dp)->running = 1;
     (*dp)->forks = malloc(num_philosophers * sizeof(pthread_mutex_t));
     if (!(*dp)->forks) {
-        logger_log(LOG_ERROR, "Failed to allocate forks");
+        LOGE("Failed to allocate forks");
         free(*dp);
         return -ENOMEM;
     }
 
     for (int i = 0; i < num_philosophers; i++) {
         if (pthread_mutex_init(&(*dp)->forks[i], NULL) != 0) {
-            logger_log(LOG_ERROR, "Failed to initialize fork %d", i);
+            LOGE("Failed to initialize fork %d", i);
             for (int j = 0; j < i; j++) {
                 pthread_mutex_destroy(&(*dp)->forks[j]);
             }
@@ -45,7 +45,7 @@ int dining_philosophers_init(dining_philosophers_t **dp, int num_philosophers) {
         }
     }
 
-    logger_log(LOG_INFO, "Dining philosophers initialized with %d philosophers", num_philosophers);
+    LOGI("Dining philosophers initialized with %d philosophers", num_philosophers);
     return 0;
 }
 
@@ -58,29 +58,29 @@ void dining_philosophers_destroy(dining_philosophers_t *dp) {
     }
     free(dp->forks);
     free(dp);
-    logger_log(LOG_INFO, "Dining philosophers destroyed");
+    LOGI("Dining philosophers destroyed");
 }
 
 int dining_philosophers_think(dining_philosophers_t *dp, int id) {
     if (!dp || id < 0 || id >= dp->num_philosophers) {
-        logger_log(LOG_ERROR, "Invalid philosopher id: %d", id);
+        LOGE("Invalid philosopher id: %d", id);
         return -EINVAL;
     }
     if (!dp->running) {
-        logger_log(LOG_WARNING, "Dining philosophers not running");
+        LOGW("Dining philosophers not running");
         return -EAGAIN;
     }
-    logger_log(LOG_DEBUG, "Philosopher %d is thinking", id);
+    LOGD("Philosopher %d is thinking", id);
     return 0;
 }
 
 int dining_philosophers_eat(dining_philosophers_t *dp, int id) {
     if (!dp || id < 0 || id >= dp->num_philosophers) {
-        logger_log(LOG_ERROR, "Invalid philosopher id: %d", id);
+        LOGE("Invalid philosopher id: %d", id);
         return -EINVAL;
     }
     if (!dp->running) {
-        logger_log(LOG_WARNING, "Dining philosophers not running");
+        LOGW("Dining philosophers not running");
         return -EAGAIN;
     }
 
@@ -92,22 +92,22 @@ int dining_philosophers_eat(dining_philosophers_t *dp, int id) {
         pthread_mutex_lock(&dp->forks[(id + 1) % dp->num_philosophers]);
         pthread_mutex_lock(&dp->forks[id]);
     }
-    logger_log(LOG_DEBUG, "Philosopher %d is eating", id);
+    LOGD("Philosopher %d is eating", id);
     return 0;
 }
 
 int dining_philosophers_done(dining_philosophers_t *dp, int id) {
     if (!dp || id < 0 || id >= dp->num_philosophers) {
-        logger_log(LOG_ERROR, "Invalid philosopher id: %d", id);
+        LOGE("Invalid philosopher id: %d", id);
         return -EINVAL;
     }
     if (!dp->running) {
-        logger_log(LOG_WARNING, "Dining philosophers not running");
+        LOGW("Dining philosophers not running");
         return -EAGAIN;
     }
 
     pthread_mutex_unlock(&dp->forks[id]);
     pthread_mutex_unlock(&dp->forks[(id + 1) % dp->num_philosophers]);
-    logger_log(LOG_DEBUG, "Philosopher %d done eating", id);
+    LOGD("Philosopher %d done eating", id);
     return 0;
 }
\ No newline at end of file
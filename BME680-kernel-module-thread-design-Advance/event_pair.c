@@ -15,7 +15,7 @@ struct event_pair {
 
 static void event_cleanup(void *arg) {
     struct event_pair *ep = (struct event_pair *)arg;
-    logger_log(LOG_INFO, "Event pair cleanup: destroying conds");
+    LOGI("Event pair cleanup: destroying conds");
     pthread_cond_destroy(&ep->cond1);
     pthread_cond_destroy(&ep->cond2);
 }
@@ -1,81 +1,149 @@
-#include <pthread.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <time.h>
 #include "fifo_semaphore.h"
 #include "logger.h"
 
-struct fifo_semaphore {
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
-    int count;
-};
+#define FIFO_SEMAPHORE_TIMEOUT_MS 5000
+#define FIFO_SEMAPHORE_SPINS 100 // Polls of head before a waiter parks
+#ifndef FIFO_SEMAPHORE_PARK_HOOK
+#define FIFO_SEMAPHORE_PARK_HOOK(ticket) // Lets fifo_semaphore_test stall a waiter right before it parks
+#endif
 
-int fifo_semaphore_init(fifo_semaphore_t *sem, int value) {
-    sem = malloc(sizeof(struct fifo_semaphore));
-    if (!sem) {
-        logger_log(LOG_ERROR, "Failed to allocate FIFO semaphore");
-        return -ENOMEM;
+/*
+ * Ticket t holds a permit once head > t. A waiter that parks publishes WAITING(t) in its
+ * slot and then rechecks head; a post bumps head and then looks at the slot of the ticket
+ * it granted. Both sides are seq_cst, so either the waiter sees the permit or the post
+ * sees WAITING(t), flips it to GRANTED(t) and wakes the slot. A waiter that times out
+ * flips WAITING(t) to ABANDONED(t) instead; whoever later grants t finds that and passes
+ * the permit on to t + 1, so a dead ticket never stalls the queue.
+ *
+ * Slot states carry the low 30 bits of the ticket. At most FIFO_SEMAPHORE_SLOTS tickets
+ * wait at once, so a slot's previous ticket already holds a permit when the next one
+ * parks there; the new waiter settles whatever that ticket left behind first, then
+ * publishes with a CAS from the state it settled. A waiter delayed before publishing can
+ * find a later ticket already parked in its slot; that ticket was only handed out once
+ * the delayed one held a permit, so the delayed waiter leaves it alone and returns.
+ */
+#define SLOT_EMPTY 0
+#define SLOT_WAITING 1
+#define SLOT_GRANTED 2
+#define SLOT_ABANDONED 3
+#define SLOT_STATE(ticket, status) ((int)((ticket) << 2 | (status)))
+
+static int fifo_semaphore_has_permit(fifo_semaphore_t *sem, unsigned ticket) {
+    return (int)(atomic_load(&sem->head) - ticket) > 0;
+}
+
+/* 1 if state belongs to a ticket handed out after ticket (compared on the 30 bits kept) */
+static int fifo_semaphore_slot_is_later(int state, unsigned ticket) {
+    unsigned diff = (((unsigned)state >> 2) - ticket) & 0x3fffffffu;
+    return state != SLOT_EMPTY && diff != 0 && diff < 0x20000000u;
+}
+
+/* Called once head has passed ticket; returns 1 if its waiter gave up and the permit must move on */
+static int fifo_semaphore_grant(fifo_semaphore_t *sem, unsigned ticket) {
+    struct fifo_semaphore_slot *slot = &sem->slots[ticket % FIFO_SEMAPHORE_SLOTS];
+    int state = atomic_load(&slot->state);
+    for (;;) {
+        if (state == SLOT_STATE(ticket, SLOT_WAITING)) {
+            if (atomic_compare_exchange_weak(&slot->state, &state, SLOT_STATE(ticket, SLOT_GRANTED))) {
+                futex_wake(&slot->state, 1);
+                return 0;
+            }
+        } else if (state == SLOT_STATE(ticket, SLOT_ABANDONED)) {
+            if (atomic_compare_exchange_weak(&slot->state, &state, SLOT_STATE(ticket, SLOT_GRANTED)))
+                return 1;
+        } else {
+            return 0; // Its waiter saw the permit without parking, or has left already
+        }
     }
-    pthread_mutex_init(&sem->mutex, NULL);
-    pthread_cond_init(&sem->cond, NULL);
+}
+
+static void fifo_semaphore_release(fifo_semaphore_t *sem) {
+    unsigned ticket;
+    do {
+        ticket = atomic_fetch_add(&sem->head, 1);
+        if ((int)(atomic_load(&sem->tail) - ticket) <= 0) return; // Nobody holds that ticket yet
+    } while (fifo_semaphore_grant(sem, ticket));
+}
+
+int fifo_semaphore_init(fifo_semaphore_t *sem, int value) {
     if (value < 0) {
-        logger_log(LOG_ERROR, "Invalid initial semaphore value: %d", value);
-        free(sem);
+        LOGE("Invalid initial semaphore value: %d", value);
         return -EINVAL;
     }
-    sem->count = value;
-    logger_log(LOG_INFO, "FIFO semaphore initialized with value %d", value);
+    atomic_init(&sem->tail, 0);
+    atomic_init(&sem->head, (unsigned)value);
+    for (int i = 0; i < FIFO_SEMAPHORE_SLOTS; i++) atomic_init(&sem->slots[i].state, SLOT_EMPTY);
+    LOGI("FIFO semaphore initialized with value %d", value);
     return 0;
 }
 
 void fifo_semaphore_destroy(fifo_semaphore_t *sem) {
-    pthread_mutex_destroy(&sem->mutex);
-    pthread_cond_destroy(&sem->cond);
-    free(sem);
-    logger_log(LOG_INFO, "FIFO semaphore destroyed");
+    int waiting = (int)(atomic_load(&sem->tail) - atomic_load(&sem->head));
+    if (waiting > 0) LOGW("FIFO semaphore destroyed with %d waiters", waiting);
+    LOGI("FIFO semaphore destroyed");
 }
 
-int fifo_semaphore_wait(fifo_semaphore_t *sem) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    ts.tv_sec += 5; // 5-second timeout
-
-    pthread_mutex_lock(&sem->mutex);
-    while (sem->count <= 0) {
-        int ret = pthread_cond_timedwait(&sem->cond, &sem->mutex, &ts);
-        if (ret == ETIMEDOUT) {
-            pthread_mutex_unlock(&sem->mutex);
-            logger_log(LOG_ERROR, "FIFO semaphore wait timed out");
-            return -ETIMEDOUT;
+/* deadline NULL: FIFO_SEMAPHORE_TIMEOUT_MS from the first sleep */
+static int fifo_semaphore_acquire(fifo_semaphore_t *sem, const struct timespec *deadline) {
+    unsigned ticket = atomic_load_explicit(&sem->tail, memory_order_relaxed);
+    do {
+        int waiting = (int)(ticket - atomic_load(&sem->head));
+        if (waiting >= FIFO_SEMAPHORE_SLOTS) {
+            LOGE("Too many FIFO semaphore waiters: %d", waiting);
+            return -EAGAIN;
         }
-        if (ret != 0) {
-            pthread_mutex_unlock(&sem->mutex);
-            logger_log(LOG_ERROR, "FIFO semaphore wait failed: %s", strerror(ret));
-            return ret;
+    } while (!atomic_compare_exchange_weak(&sem->tail, &ticket, ticket + 1));
+
+    for (int spins = 0; spins < FIFO_SEMAPHORE_SPINS; spins++) {
+        if (fifo_semaphore_has_permit(sem, ticket)) return 0;
+        cpu_relax();
+    }
+
+    struct fifo_semaphore_slot *slot = &sem->slots[ticket % FIFO_SEMAPHORE_SLOTS];
+    int waiting = SLOT_STATE(ticket, SLOT_WAITING);
+    int granted = SLOT_STATE(ticket, SLOT_GRANTED);
+    FIFO_SEMAPHORE_PARK_HOOK(ticket);
+    for (;;) {
+        if (fifo_semaphore_has_permit(sem, ticket)) return 0;
+        int state = atomic_load(&slot->state);
+        if (fifo_semaphore_slot_is_later(state, ticket)) continue; // We hold a permit; head shows it next
+        if (fifo_semaphore_grant(sem, (unsigned)state >> 2)) {
+            fifo_semaphore_release(sem);
+            continue;
         }
+        if (atomic_compare_exchange_strong(&slot->state, &state, waiting)) break;
     }
-    if (sem->count < 0) {
-        pthread_mutex_unlock(&sem->mutex);
-        logger_log(LOG_ERROR, "Invalid semaphore count: %d", sem->count);
-        return -EINVAL;
+
+    struct timespec ts;
+    while (atomic_load(&slot->state) != granted && !fifo_semaphore_has_permit(sem, ticket)) {
+        if (!deadline) {
+            deadline_from_ms(&ts, FIFO_SEMAPHORE_TIMEOUT_MS);
+            deadline = &ts;
+        }
+        if (futex_wait(&slot->state, waiting, deadline) != -ETIMEDOUT) continue;
+        int expected = waiting;
+        if (atomic_compare_exchange_strong(&slot->state, &expected, SLOT_STATE(ticket, SLOT_ABANDONED))) {
+            LOGE("FIFO semaphore wait timed out");
+            return -ETIMEDOUT;
+        }
     }
-    sem->count--;
-    pthread_mutex_unlock(&sem->mutex);
-    logger_log(LOG_DEBUG, "FIFO semaphore acquired, count=%d", sem->count);
+    LOGD("FIFO semaphore acquired, ticket=%u", ticket);
     return 0;
 }
 
+int fifo_semaphore_wait(fifo_semaphore_t *sem) {
+    return fifo_semaphore_acquire(sem, NULL);
+}
+
+int fifo_semaphore_timedwait(fifo_semaphore_t *sem, const struct timespec *deadline) {
+    return fifo_semaphore_acquire(sem, deadline);
+}
+
 int fifo_semaphore_post(fifo_semaphore_t *sem) {
-    pthread_mutex_lock(&sem->mutex);
-    sem->count++;
-    if (sem->count < 0) {
-        pthread_mutex_unlock(&sem->mutex);
-        logger_log(LOG_ERROR, "Invalid semaphore count: %d", sem->count);
-        return -EINVAL;
-    }
-    pthread_cond_signal(&sem->cond);
-    pthread_mutex_unlock(&sem->mutex);
-    logger_log(LOG_DEBUG, "FIFO semaphore released, count=%d", sem->count);
+    fifo_semaphore_release(sem);
+    LOGD("FIFO semaphore released");
     return 0;
-}
\ No newline at end of file
+}
@@ -1,11 +1,35 @@
 #ifndef FIFO_SEMAPHORE_H
 #define FIFO_SEMAPHORE_H
 
-typedef struct fifo_semaphore fifo_semaphore_t;
+#include <stdatomic.h>
+#include <time.h>
+#include "sync_util.h"
+
+#define FIFO_SEMAPHORE_SLOTS 64 // Most tickets that may be waiting at once
+
+/*
+ * Ticket semaphore. A waiter takes the next ticket; permits are handed out in ticket
+ * order, so waiters are served strictly first come, first served. A waiter that has to
+ * sleep parks on the futex word of its own slot (ticket % FIFO_SEMAPHORE_SLOTS), and a
+ * post wakes only the slot of the ticket it grants: one wake-up per post, no herd.
+ * Embed it and fifo_semaphore_init() it.
+ */
+struct fifo_semaphore_slot {
+    _Alignas(CACHE_LINE_SIZE) atomic_int state; // Ticket parked here and its status
+};
+
+typedef struct fifo_semaphore {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint tail; // Next ticket to hand out
+    _Alignas(CACHE_LINE_SIZE) atomic_uint head; // Tickets below this hold a permit
+    struct fifo_semaphore_slot slots[FIFO_SEMAPHORE_SLOTS];
+} fifo_semaphore_t;
 
 int fifo_semaphore_init(fifo_semaphore_t *sem, int value);
 void fifo_semaphore_destroy(fifo_semaphore_t *sem);
+/* 5 s timeout; -EAGAIN if FIFO_SEMAPHORE_SLOTS tickets are already waiting */
 int fifo_semaphore_wait(fifo_semaphore_t *sem);
+/* deadline is an absolute CLOCK_MONOTONIC time */
+int fifo_semaphore_timedwait(fifo_semaphore_t *sem, const struct timespec *deadline);
 int fifo_semaphore_post(fifo_semaphore_t *sem);
 
-#endif /* FIFO_SEMAPHORE_H */
\ No newline at end of file
+#endif /* FIFO_SEMAPHORE_H */
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include "fifo_semaphore.h"
+#include "logger.h"
+
+/* Throughput and fairness of fifo_semaphore_t, the previous condvar version and sem_t as a lock: ./fifo_semaphore_bench [-n ops] */
+
+#define BENCH_MAX_THREADS 32
+#define BENCH_HOLD_SPINS 10   // Work inside the semaphore
+#define BENCH_THINK_SPINS 40  // Work between releases and the next wait
+
+/*
+ * Previous implementation: one mutex and condvar, pthread_cond_signal on post. The condvar
+ * is put on CLOCK_MONOTONIC here; the original waited on a monotonic deadline with a
+ * CLOCK_REALTIME condvar, so every wait that had to sleep timed out at once.
+ */
+struct legacy_semaphore {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int count;
+};
+
+static void legacy_init(struct legacy_semaphore *sem, int value) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&sem->mutex, NULL);
+    pthread_cond_init(&sem->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    sem->count = value;
+}
+
+static int legacy_wait(struct legacy_semaphore *sem) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += 5;
+    pthread_mutex_lock(&sem->mutex);
+    while (sem->count <= 0) {
+        if (pthread_cond_timedwait(&sem->cond, &sem->mutex, &ts) == ETIMEDOUT) {
+            pthread_mutex_unlock(&sem->mutex);
+            return -ETIMEDOUT;
+        }
+    }
+    sem->count--;
+    pthread_mutex_unlock(&sem->mutex);
+    return 0;
+}
+
+static void legacy_post(struct legacy_semaphore *sem) {
+    pthread_mutex_lock(&sem->mutex);
+    sem->count++;
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->mutex);
+}
+
+enum bench_sem { BENCH_TICKET, BENCH_LEGACY, BENCH_POSIX };
+
+static const char *bench_names[] = { "ticket", "condvar", "sem_t" };
+
+struct bench_arg {
+    enum bench_sem kind;
+    int id;
+    long acquired;
+    int failures;
+};
+
+static fifo_semaphore_t ticket_sem;
+static struct legacy_semaphore legacy_sem;
+static sem_t posix_sem;
+static pthread_barrier_t start_barrier;
+
+/* Only touched while holding the semaphore (value 1) */
+static long total_ops, done_ops;
+static int last_owner;
+static long run_length, longest_run;
+
+static void *bench_thread(void *arg) {
+    struct bench_arg *b = (struct bench_arg *)arg;
+    pthread_barrier_wait(&start_barrier);
+    for (;;) {
+        int ret;
+        if (b->kind == BENCH_TICKET) ret = fifo_semaphore_wait(&ticket_sem);
+        else if (b->kind == BENCH_LEGACY) ret = legacy_wait(&legacy_sem);
+        else ret = sem_wait(&posix_sem);
+        if (ret != 0) {
+            b->failures++;
+            continue;
+        }
+        int finished = done_ops >= total_ops;
+        if (!finished) {
+            done_ops++;
+            b->acquired++;
+            /* Consecutive grants to one thread; strict FIFO keeps this at 1 while others queue */
+            run_length = last_owner == b->id ? run_length + 1 : 1;
+            last_owner = b->id;
+            if (run_length > longest_run) longest_run = run_length;
+            for (int i = 0; i < BENCH_HOLD_SPINS; i++) cpu_relax();
+        }
+        if (b->kind == BENCH_TICKET) fifo_semaphore_post(&ticket_sem);
+        else if (b->kind == BENCH_LEGACY) legacy_post(&legacy_sem);
+        else sem_post(&posix_sem);
+        if (finished) return NULL;
+        for (int i = 0; i < BENCH_THINK_SPINS; i++) cpu_relax();
+    }
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_run(enum bench_sem kind, int threads, long ops) {
+    pthread_t tids[threads];
+    struct bench_arg args[threads];
+    int failures = 0;
+
+    total_ops = ops;
+    done_ops = 0;
+    last_owner = -1;
+    run_length = longest_run = 0;
+    pthread_barrier_init(&start_barrier, NULL, threads + 1);
+    for (int i = 0; i < threads; i++) {
+        args[i] = (struct bench_arg){ .kind = kind, .id = i };
+        pthread_create(&tids[i], NULL, bench_thread, &args[i]);
+    }
+    pthread_barrier_wait(&start_barrier);
+    double start = bench_now();
+    long min = ops, max = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+        failures += args[i].failures;
+        if (args[i].acquired < min) min = args[i].acquired;
+        if (args[i].acquired > max) max = args[i].acquired;
+    }
+    double elapsed = bench_now() - start;
+    pthread_barrier_destroy(&start_barrier);
+    double fair = (double)ops / threads;
+    printf("%-7s %2d waiters %8.1f ns/op %7.2f M ops/s  share min %5.1f%% max %6.1f%% of fair  longest run %ld%s\n",
+           bench_names[kind], threads, elapsed * 1e9 / ops, ops / elapsed / 1e6, min * 100.0 / fair,
+           max * 100.0 / fair, longest_run, failures ? " (failures)" : "");
+}
+
+int main(int argc, char *argv[]) {
+    long ops = 200000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ops = atol(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-n ops]\n", argv[0]);
+            return 1;
+        }
+    }
+    logger_init("fifo_semaphore_bench.log");
+    logger_set_level(LOG_WARNING);
+    fifo_semaphore_init(&ticket_sem, 1);
+    legacy_init(&legacy_sem, 1);
+    sem_init(&posix_sem, 0, 1);
+
+    for (int threads = 2; threads <= BENCH_MAX_THREADS; threads *= 2) {
+        for (int kind = BENCH_TICKET; kind <= BENCH_POSIX; kind++) bench_run(kind, threads, ops);
+    }
+
+    sem_destroy(&posix_sem);
+    pthread_cond_destroy(&legacy_sem.cond);
+    pthread_mutex_destroy(&legacy_sem.mutex);
+    fifo_semaphore_destroy(&ticket_sem);
+    logger_destroy();
+    return 0;
+}
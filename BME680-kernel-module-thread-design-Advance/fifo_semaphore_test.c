@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/* Regression test for a slot reused while its previous waiter is still inside acquire: ./fifo_semaphore_test */
+
+static atomic_int hook_entered, hook_release;
+static void test_park_hook(unsigned ticket);
+#define FIFO_SEMAPHORE_PARK_HOOK(ticket) test_park_hook(ticket)
+#include "fifo_semaphore.c"
+
+#define TEST_WAITERS (FIFO_SEMAPHORE_SLOTS + 1) // Tickets 0..64: 0 and 64 share slot 0
+#define TEST_TIMEOUT_MS 300
+
+static fifo_semaphore_t sem;
+static atomic_int acquired[TEST_WAITERS];
+
+/* Stall ticket 0 after its spin phase, before it publishes in its slot */
+static void test_park_hook(unsigned ticket) {
+    if (ticket != 0) return;
+    atomic_store(&hook_entered, 1);
+    while (!atomic_load(&hook_release)) sched_yield();
+}
+
+static void *test_waiter(void *arg) {
+    int id = (int)(long)arg;
+    struct timespec deadline;
+    deadline_from_ms(&deadline, id == 0 ? 5000 : TEST_TIMEOUT_MS);
+    if (fifo_semaphore_timedwait(&sem, &deadline) == 0) atomic_store(&acquired[id], 1);
+    return NULL;
+}
+
+static void test_wait_for(int (*cond)(void)) {
+    while (!cond()) sched_yield();
+}
+
+static int test_hook_entered(void) {
+    return atomic_load(&hook_entered);
+}
+
+static int test_last_parked(void) {
+    return atomic_load(&sem.slots[0].state) == SLOT_STATE(TEST_WAITERS - 1, SLOT_WAITING);
+}
+
+int main(void) {
+    pthread_t tids[TEST_WAITERS];
+    int granted = 0;
+
+    logger_init("fifo_semaphore_test.log");
+    logger_set_level(LOG_WARNING);
+    fifo_semaphore_init(&sem, 0);
+
+    pthread_create(&tids[0], NULL, test_waiter, (void *)0L);
+    test_wait_for(test_hook_entered);
+    fifo_semaphore_post(&sem); // The only permit, for ticket 0, which lets ticket 64 in
+    for (long i = 1; i < TEST_WAITERS; i++) {
+        pthread_create(&tids[i], NULL, test_waiter, (void *)i);
+        while ((int)atomic_load(&sem.tail) <= i) sched_yield(); // Hand out tickets in thread order
+    }
+    test_wait_for(test_last_parked);
+    atomic_store(&hook_release, 1);
+    for (int i = 0; i < TEST_WAITERS; i++) pthread_join(tids[i], NULL);
+
+    for (int i = 0; i < TEST_WAITERS; i++) granted += atomic_load(&acquired[i]);
+    fifo_semaphore_destroy(&sem);
+    logger_destroy();
+    if (granted != 1 || !atomic_load(&acquired[0])) {
+        printf("FAIL: one post let %d waiters through (ticket 0 %s, ticket %d %s)\n", granted,
+               atomic_load(&acquired[0]) ? "acquired" : "did not",
+               TEST_WAITERS - 1, atomic_load(&acquired[TEST_WAITERS - 1]) ? "acquired" : "did not");
+        return 1;
+    }
+    printf("PASS: slot reuse under a stalled waiter, one post, one acquisition\n");
+    return 0;
+}
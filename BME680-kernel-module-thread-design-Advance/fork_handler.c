@@ -15,7 +15,7 @@ struct fork_handler {
 
 static void fork_cleanup(void *arg) {
     fork_handler_t *fh = (fork_handler_t *)arg;
-    logger_log(LOG_INFO, "Fork cleanup: canceling other threads");
+    LOGI("Fork cleanup: canceling other threads");
     for (int i = 0; i < fh->num_threads; i++) {
         if (fh->threads[i] != pthread_self()) {
             pthread_cancel(fh->threads[i]);
@@ -26,7 +26,7 @@ static void fork_cleanup(void *arg) {
 static void *worker_thread(void *arg) {
     fork_handler_t *fh = (fork_handler_t *)arg;
     while (fh->running) {
-        logger_log(LOG_DEBUG, "Worker thread %lu running", (unsigned long)pthread_self());
+        LOGD("Worker thread %lu running", (unsigned long)pthread_self());
         sleep(1);
     }
     return NULL;
@@ -35,12 +35,12 @@ static void *worker_thread(void *arg) {
 int fork_handler_init(fork_handler_t *fh, int num_threads) {
     fh = malloc(sizeof(fork_handler_t));
     if (!fh) {
-        logger_log(LOG_ERROR, "Failed to allocate fork handler");
+        LOGE("Failed to allocate fork handler");
         return -ENOMEM;
     }
     fh->threads = malloc(num_threads * sizeof(pthread_t));
     if (!fh->threads) {
-        logger_log(LOG_ERROR, "Failed to allocate thread array");
+        LOGE("Failed to allocate thread array");
         free(fh);
         return -ENOMEM;
     }
@@ -49,12 +49,12 @@ int fork_handler_init(fork_handler_t *fh, int num_threads) {
     fh->running = 1;
     for (int i = 0; i < num_threads; i++) {
         if (pthread_create(&fh->threads[i], NULL, worker_thread, fh) != 0) {
-            logger_log(LOG_ERROR, "Failed to create thread %d", i);
+            LOGE("Failed to create thread %d", i);
             fork_handler_destroy(fh);
             return -1;
         }
     }
-    logger_log(LOG_INFO, "Fork handler initialized with %d threads", num_threads);
+    LOGI("Fork handler initialized with %d threads", num_threads);
     return 0;
 }
 
@@ -68,7 +68,7 @@ void fork_handler_destroy(fork_handler_t *fh) {
     pthread_mutex_destroy(&fh->mutex);
     free(fh->threads);
     free(fh);
-    logger_log(LOG_INFO, "Fork handler destroyed");
+    LOGI("Fork handler destroyed");
 }
 
 int fork_handler_fork(fork_handler_t *fh) {
@@ -76,7 +76,7 @@ int fork_handler_fork(fork_handler_t *fh) {
     clock_gettime(CLOCK_MONOTONIC, &ts);
     ts.tv_sec += 5;
     if (pthread_mutex_timedlock(&fh->mutex, &ts) != 0) {
-        logger_log(LOG_ERROR, "Timed out locking mutex for fork");
+        LOGE("Timed out locking mutex for fork");
         return -ETIMEDOUT;
     }
     pthread_cleanup_push(fork_cleanup, fh); // Cleanup if canceled
@@ -84,12 +84,12 @@ int fork_handler_fork(fork_handler_t *fh) {
     if (pid == -1) {
         pthread_cleanup_pop(0);
         pthread_mutex_unlock(&fh->mutex);
-        logger_log(LOG_ERROR, "Fork failed: %s", strerror(errno));
+        LOGE("Fork failed: %s", strerror(errno));
         return -errno;
     }
     if (pid == 0) {
         // Child process
-        logger_log(LOG_INFO, "Child process created with PID %d", getpid());
+        LOGI("Child process created with PID %d", getpid());
         // Cancel other threads
         for (int i = 0; i < fh->num_threads; i++) {
             if (fh->threads[i] != pthread_self()) {
@@ -100,16 +100,16 @@ int fork_handler_fork(fork_handler_t *fh) {
         pthread_mutex_unlock(&fh->mutex);
         // Child tasks
         sleep(2);
-        logger_log(LOG_INFO, "Child process exiting");
+        LOGI("Child process exiting");
         exit(0);
     } else {
         // Parent
-        logger_log(LOG_INFO, "Parent process forked child with PID %d", pid);
+        LOGI("Parent process forked child with PID %d", pid);
         int status;
         waitpid(pid, &status, 0);
         pthread_cleanup_pop(0);
         pthread_mutex_unlock(&fh->mutex);
-        logger_log(LOG_INFO, "Child process %d exited with status %d", pid, status);
+        LOGI("Child process %d exited with status %d", pid, status);
     }
     return 0;
 }
\ No newline at end of file
@@ -23,20 +23,20 @@ static int sem_timedwait(int semid, struct timespec *ts) {
 int ipc_sync_init(struct bme680_ipc_sync **ipc, key_t key) {
     *ipc = malloc(sizeof(struct bme680_ipc_sync));
     if (!*ipc) {
-        logger_log(LOG_ERROR, "Failed to allocate IPC sync");
+        LOGE("Failed to allocate IPC sync");
         return -ENOMEM;
     }
 
     (*ipc)->shmid = shmget(key, sizeof(struct bme680_fifo_data), IPC_CREAT | 0666);
     if ((*ipc)->shmid < 0) {
-        logger_log(LOG_ERROR, "Failed to create shared memory: %s", strerror(errno));
+        LOGE("Failed to create shared memory: %s", strerror(errno));
         free(*ipc);
         return -errno;
     }
 
     (*ipc)->data = shmat((*ipc)->shmid, NULL, 0);
     if ((*ipc)->data == (void *)-1) {
-        logger_log(LOG_ERROR, "Failed to attach shared memory: %s", strerror(errno));
+        LOGE("Failed to attach shared memory: %s", strerror(errno));
         shmctl((*ipc)->shmid, IPC_RMID, NULL);
         free(*ipc);
         return -errno;
@@ -44,7 +44,7 @@ int ipc_sync_init(struct bme680_ipc_sync **ipc, key_t key) {
 
     (*ipc)->semid = semget(key, 1, IPC_CREAT | 0666);
     if ((*ipc)->semid < 0) {
-        logger_log(LOG_ERROR, "Failed to create semaphore: %s", strerror(errno));
+        LOGE("Failed to create semaphore: %s", strerror(errno));
         shmdt((*ipc)->data);
         shmctl((*ipc)->shmid, IPC_RMID, NULL);
         free(*ipc);
@@ -58,7 +58,7 @@ int ipc_sync_init(struct bme680_ipc_sync **ipc, key_t key) {
     } sem_arg;
     sem_arg.val = 1;
     if (semctl((*ipc)->semid, 0, SETVAL, sem_arg) < 0) {
-        logger_log(LOG_ERROR, "Failed to initialize semaphore: %s", strerror(errno));
+        LOGE("Failed to initialize semaphore: %s", strerror(errno));
         shmdt((*ipc)->data);
         shmctl((*ipc)->shmid, IPC_RMID, NULL);
         semctl((*ipc)->semid, 0, IPC_RMID);
@@ -66,7 +66,7 @@ int ipc_sync_init(struct bme680_ipc_sync **ipc, key_t key) {
         return -errno;
     }
 
-    logger_log(LOG_INFO, "IPC sync initialized with key %d", key);
+    LOGI("IPC sync initialized with key %d", key);
     return 0;
 }
 
@@ -75,7 +75,7 @@ void ipc_sync_destroy(struct bme680_ipc_sync *ipc) {
     shmctl(ipc->shmid, IPC_RMID, NULL);
     semctl(ipc->semid, 0, IPC_RMID);
     free(ipc);
-    logger_log(LOG_INFO, "IPC sync destroyed");
+    LOGI("IPC sync destroyed");
 }
 
 int ipc_sync_write(struct bme680_ipc_sync *ipc, struct bme680_fifo_data *data) {
@@ -84,22 +84,22 @@ int ipc_sync_write(struct bme680_ipc_sync *ipc, struct bme680_fifo_data *data) {
     ts.tv_sec += 5; // 5-second timeout
 
     if (data->temp < -40 || data->temp > 85 || data->pressure < 30000 || data->pressure > 110000 || data->humidity < 0 || data->humidity > 100) {
-        logger_log(LOG_ERROR, "Invalid sensor data: temp=%f, pressure=%u, humidity=%u", data->temp, data->pressure, data->humidity);
+        LOGE("Invalid sensor data: temp=%f, pressure=%u, humidity=%u", data->temp, data->pressure, data->humidity);
         return -EINVAL;
     }
 
     if (sem_timedwait(ipc->semid, &ts) < 0) {
-        logger_log(LOG_ERROR, "Semaphore wait failed: %s", strerror(errno));
+        LOGE("Semaphore wait failed: %s", strerror(errno));
         return -errno;
     }
 
     memcpy(ipc->data, data, sizeof(struct bme680_fifo_data));
     if (semop(ipc->semid, &(struct sembuf){0, 1, 0}, 1) < 0) {
-        logger_log(LOG_ERROR, "Semaphore post failed: %s", strerror(errno));
+        LOGE("Semaphore post failed: %s", strerror(errno));
         return -errno;
     }
 
-    logger_log(LOG_DEBUG, "IPC sync write completed");
+    LOGD("IPC sync write completed");
     return 0;
 }
 
@@ -109,22 +109,22 @@ int ipc_sync_read(struct bme680_ipc_sync *ipc, struct bme680_fifo_data *data) {
     ts.tv_sec += 5; // 5-second timeout
 
     if (sem_timedwait(ipc->semid, &ts) < 0) {
-        logger_log(LOG_ERROR, "Semaphore wait failed: %s", strerror(errno));
+        LOGE("Semaphore wait failed: %s", strerror(errno));
         return -errno;
     }
 
     memcpy(data, ipc->data, sizeof(struct bme680_fifo_data));
     if (data->temp < -40 || data->temp > 85 || data->pressure < 30000 || data->pressure > 110000 || data->humidity < 0 || data->humidity > 100) {
-        logger_log(LOG_ERROR, "Invalid sensor data read: temp=%f, pressure=%u, humidity=%u", data->temp, data->pressure, data->humidity);
+        LOGE("Invalid sensor data read: temp=%f, pressure=%u, humidity=%u", data->temp, data->pressure, data->humidity);
         semop(ipc->semid, &(struct sembuf){0, 1, 0}, 1);
         return -EINVAL;
     }
 
     if (semop(ipc->semid, &(struct sembuf){0, 1, 0}, 1) < 0) {
-        logger_log(LOG_ERROR, "Semaphore post failed: %s", strerror(errno));
+        LOGE("Semaphore post failed: %s", strerror(errno));
         return -errno;
     }
 
-    logger_log(LOG_DEBUG, "IPC sync read completed");
+    LOGD("IPC sync read completed");
     return 0;
 }
\ No newline at end of file
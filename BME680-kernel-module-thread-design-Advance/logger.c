@@ -5,16 +5,96 @@
 #include <pthread.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
 #include "logger.h"
+#include "logger_binary.h"
+#include "sync_util.h"
+
+#define LOGGER_DEFAULT_RING 4096
+#define LOGGER_DEFAULT_FLUSH_BYTES (32 * 1024)
+#define LOGGER_DEFAULT_FLUSH_MS 200
+#define LOGGER_BATCH_MAX (64 * 1024) // Writer buffer; must exceed flush_bytes plus one line
+#define LOGGER_ERROR_RETRIES 10000 // Yields an ERROR line waits for ring space before it is dropped
+#define LOGGER_MAX_FORMATS 1024
+#define LOGGER_FORMAT_SLOTS 2048 // Call-site hash; power of two, larger than LOGGER_MAX_FORMATS
+#define LOGGER_FORMAT_MAX 512    // Longer format strings are logged preformatted
+#define LOGGER_MAP_WINDOW (1024 * 1024) // Bytes of the active segment mapped at a time
+#define LOGGER_MIN_SEGMENT (2 * LOGGER_MAP_WINDOW) // Must hold a batch plus a binary preamble
+#define LOGGER_DEFAULT_SEGMENTS 4
+
+/*
+ * Async mode: callers claim a ring slot (Vyukov MPMC ticket, used here with a single
+ * consumer), vsnprintf the message into it and publish it. They never take a lock or
+ * make a syscall, except to wake the writer for an ERROR line or a half-full ring.
+ * The writer stamps the time prefix, batches lines and issues one large write().
+ *
+ * Binary mode skips formatting altogether: each format string is registered once by
+ * address and gets an id, and a call only copies the id, a monotonic timestamp and its
+ * raw arguments into the slot (see logger_binary.h). The writer emits a format's
+ * definition before its first record; bme680_logdump turns the file back into text.
+ *
+ * Segment mode bounds disk usage: output goes to filename, preallocated to segment_size
+ * and written through a mmap window, so a line costs a memcpy rather than a syscall.
+ * When it would overflow, it is cut to its used length and renamed to filename.1 (older
+ * ones shift up, the oldest past max_segments is dropped) and a fresh one is started.
+ * A binary segment restates the session and every format in use, so each decodes alone.
+ */
+struct log_slot {
+    atomic_ulong seq;
+    time_t sec;
+    log_level_t level;
+    int len;
+    char text[LOGGER_LINE_MAX]; // Formatted line, or a binary record
+};
+
+struct log_format {
+    const char *fmt;
+    uint8_t nargs;
+    uint8_t types[LOGBIN_MAX_ARGS];
+    uint16_t fixed_bytes; // Encoded size of the non-string arguments plus string lengths
+};
 
 struct logger {
     FILE *log_file;
-    pthread_mutex_t mutex;
-    log_level_t level;
+    pthread_mutex_t mutex; // Sync mode writes
+    int async;
+    struct log_slot *slots;
+    unsigned long mask;
+    int flush_bytes;
+    int flush_interval_ms;
+    pthread_t writer;
+    atomic_int stop;
+    atomic_ullong dropped;
+    _Alignas(CACHE_LINE_SIZE) atomic_ulong write_pos;
+    _Alignas(CACHE_LINE_SIZE) atomic_int wake; // Futex word the writer sleeps on
+    atomic_int writer_waiting;
+    int binary;
+    struct log_format formats[LOGGER_MAX_FORMATS]; // Id 0 is "%s", used for formats that cannot be encoded
+    int num_formats;
+    _Atomic(const char *) format_keys[LOGGER_FORMAT_SLOTS];
+    int format_ids[LOGGER_FORMAT_SLOTS]; // -1: the format cannot be encoded
+    size_t segment_size; // 0: plain append to log_file
+    int max_segments;
+    char path[PATH_MAX];
+    int seg_fd;
+    char *map;        // Window of the active segment, NULL if mapping failed
+    size_t map_start; // Segment offset of the window
+    size_t seg_used;
 };
 
 static struct logger logger;
 
+atomic_int logger_level = LOG_INFO;
+
+/* Sync mode: each caller keeps its own formatted second, so localtime_r runs once per second per thread */
+static __thread time_t tls_stamp_sec = -1;
+static __thread char tls_stamp[32];
+
 const char *log_level_str[] = {
     [LOG_DEBUG] = "DEBUG",
     [LOG_INFO] = "INFO",
@@ -22,32 +102,519 @@ const char *log_level_str[] = {
     [LOG_ERROR] = "ERROR"
 };
 
+/* Appends "[timestamp] [LEVEL] " to buf; caches the formatted second per caller */
+static int logger_prefix(char *buf, size_t size, time_t sec, log_level_t level, time_t *cached_sec, char *cached) {
+    if (sec != *cached_sec) {
+        struct tm tm_info;
+        localtime_r(&sec, &tm_info);
+        strftime(cached, 32, "%Y-%m-%d %H:%M:%S", &tm_info);
+        *cached_sec = sec;
+    }
+    return snprintf(buf, size, "[%s] [%s] ", cached, log_level_str[level]);
+}
+
+static void logger_write_all(const char *buf, size_t len) {
+    int fd = fileno(logger.log_file);
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Failed to write to log file: %s\n", strerror(errno));
+            return;
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+static int logger_segment_map(size_t start) {
+    if (logger.map) munmap(logger.map, LOGGER_MAP_WINDOW);
+    logger.map = mmap(NULL, LOGGER_MAP_WINDOW, PROT_READ | PROT_WRITE, MAP_SHARED, logger.seg_fd, start);
+    if (logger.map == MAP_FAILED) {
+        int ret = -errno;
+        logger.map = NULL;
+        fprintf(stderr, "Failed to map log segment: %s\n", strerror(-ret));
+        return ret;
+    }
+    logger.map_start = start;
+    return 0;
+}
+
+/* Shifts filename.(k-1) to filename.k, dropping the oldest, then preallocates a fresh filename */
+static int logger_segment_open(void) {
+    char from[PATH_MAX + 16], to[PATH_MAX + 16];
+    for (int k = logger.max_segments - 1; k >= 1; k--) {
+        if (k == 1) snprintf(from, sizeof(from), "%s", logger.path);
+        else snprintf(from, sizeof(from), "%s.%d", logger.path, k - 1);
+        snprintf(to, sizeof(to), "%s.%d", logger.path, k);
+        if (rename(from, to) != 0 && errno != ENOENT)
+            fprintf(stderr, "Failed to rotate %s: %s\n", from, strerror(errno));
+    }
+    logger.seg_fd = open(logger.path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (logger.seg_fd < 0) return -errno;
+    /* Reserve the blocks up front: stores into the mapping cannot then fail with SIGBUS on a full card */
+    int ret = posix_fallocate(logger.seg_fd, 0, logger.segment_size);
+    if (ret != 0) {
+        close(logger.seg_fd);
+        logger.seg_fd = -1;
+        return -ret;
+    }
+    logger.seg_used = 0;
+    logger.map = NULL;
+    return logger_segment_map(0);
+}
+
+/* Cuts the preallocated tail so the file ends at the last line */
+static void logger_segment_close(void) {
+    if (logger.seg_fd < 0) return;
+    if (logger.map) munmap(logger.map, LOGGER_MAP_WINDOW);
+    logger.map = NULL;
+    if (ftruncate(logger.seg_fd, logger.seg_used) != 0)
+        fprintf(stderr, "Failed to truncate log segment: %s\n", strerror(errno));
+    close(logger.seg_fd);
+    logger.seg_fd = -1;
+}
+
+/* A text segment left at full size by a crash ends in NUL padding; trim it before it is rotated out */
+static void logger_segment_trim(const char *path) {
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) return;
+    off_t end = lseek(fd, 0, SEEK_END);
+    char buf[4096];
+    while (end > 0) {
+        size_t n = end < (off_t)sizeof(buf) ? (size_t)end : sizeof(buf);
+        if (pread(fd, buf, n, end - n) != (ssize_t)n) {
+            close(fd);
+            return;
+        }
+        while (n > 0 && buf[n - 1] == '\0') {
+            n--;
+            end--;
+        }
+        if (n > 0) break;
+    }
+    if (ftruncate(fd, end) != 0) fprintf(stderr, "Failed to trim %s: %s\n", path, strerror(errno));
+    close(fd);
+}
+
+/* Copies into the active segment, sliding the window as it fills; the caller checked that it fits */
+static void logger_segment_write(const char *buf, size_t len) {
+    while (len > 0 && logger.map) {
+        size_t off = logger.seg_used - logger.map_start;
+        if (off == LOGGER_MAP_WINDOW) {
+            if (logger_segment_map(logger.map_start + LOGGER_MAP_WINDOW) != 0) return;
+            off = 0;
+        }
+        size_t n = LOGGER_MAP_WINDOW - off < len ? LOGGER_MAP_WINDOW - off : len;
+        memcpy(logger.map + off, buf, n);
+        logger.seg_used += n;
+        buf += n;
+        len -= n;
+    }
+}
+
+static int logger_segment_rotate(size_t len) {
+    if (logger.seg_fd >= 0 && logger.seg_used + len <= logger.segment_size) return 0;
+    logger_segment_close();
+    int ret = logger_segment_open();
+    if (ret != 0) fprintf(stderr, "Failed to open log segment %s: %s\n", logger.path, strerror(-ret));
+    return ret;
+}
+
+static void logger_close_output(void) {
+    if (logger.segment_size) {
+        logger_segment_close();
+        logger.segment_size = 0;
+    } else if (logger.log_file) {
+        fclose(logger.log_file);
+        logger.log_file = NULL;
+    }
+}
+
+static void logger_notify(void) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&logger.writer_waiting, memory_order_relaxed)) {
+        atomic_fetch_add(&logger.wake, 1);
+        futex_wake(&logger.wake, 1);
+    }
+}
+
+/* Records the argument types printf would consume; -1 for anything we cannot replay */
+static int logger_parse_format(const char *fmt, struct log_format *f) {
+    f->fmt = fmt;
+    f->nargs = 0;
+    f->fixed_bytes = 0;
+    for (const char *p = fmt; *p; p++) {
+        if (*p != '%') continue;
+        if (*++p == '%') continue;
+        uint8_t types[3];
+        int n = 0;
+        while (*p && strchr("-+ #0'", *p)) p++;
+        if (*p == '*') {
+            types[n++] = LOGBIN_ARG_INT32;
+            p++;
+        }
+        while (isdigit((unsigned char)*p)) p++;
+        if (*p == '.') {
+            if (*++p == '*') {
+                types[n++] = LOGBIN_ARG_INT32;
+                p++;
+            }
+            while (isdigit((unsigned char)*p)) p++;
+        }
+        size_t width = sizeof(int);
+        for (;; p++) {
+            if (*p == 'h') continue;
+            else if (*p == 'l') width = width == sizeof(int) ? sizeof(long) : sizeof(long long);
+            else if (*p == 'j') width = sizeof(long long);
+            else if (*p == 'z' || *p == 't') width = sizeof(size_t);
+            else break;
+        }
+        switch (*p) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            types[n++] = width == 8 ? LOGBIN_ARG_INT64 : LOGBIN_ARG_INT32;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            types[n++] = LOGBIN_ARG_DOUBLE;
+            break;
+        case 's':
+            if (width != sizeof(int)) return -1; // Wide string
+            types[n++] = LOGBIN_ARG_STRING;
+            break;
+        case 'p':
+            types[n++] = LOGBIN_ARG_PTR;
+            break;
+        default:
+            return -1; // %n, long double, wide char, or a truncated spec
+        }
+        for (int i = 0; i < n; i++) {
+            if (f->nargs == LOGBIN_MAX_ARGS) return -1;
+            f->types[f->nargs++] = types[i];
+            f->fixed_bytes += types[i] == LOGBIN_ARG_INT32 ? 4 : types[i] == LOGBIN_ARG_STRING ? 2 : 8;
+        }
+    }
+    return 0;
+}
+
+static unsigned logger_format_hash(const char *fmt) {
+    return (unsigned)(((uintptr_t)fmt >> 2) * 2654435761u) & (LOGGER_FORMAT_SLOTS - 1);
+}
+
+/* A call site's format id, looked up lock-free by string address and registered on first use */
+static int logger_format_id(const char *fmt) {
+    unsigned idx = logger_format_hash(fmt);
+    for (int i = 0; i < LOGGER_FORMAT_SLOTS; i++, idx = (idx + 1) & (LOGGER_FORMAT_SLOTS - 1)) {
+        const char *key = atomic_load_explicit(&logger.format_keys[idx], memory_order_acquire);
+        if (key == fmt) return logger.format_ids[idx];
+        if (!key) break;
+    }
+    pthread_mutex_lock(&logger.mutex);
+    int id = -1;
+    idx = logger_format_hash(fmt);
+    for (int i = 0; i < LOGGER_FORMAT_SLOTS; i++, idx = (idx + 1) & (LOGGER_FORMAT_SLOTS - 1)) {
+        const char *key = atomic_load_explicit(&logger.format_keys[idx], memory_order_relaxed);
+        if (key == fmt) {
+            pthread_mutex_unlock(&logger.mutex);
+            return logger.format_ids[idx];
+        }
+        if (!key) break;
+    }
+    if (logger.num_formats < LOGGER_MAX_FORMATS && strlen(fmt) < LOGGER_FORMAT_MAX &&
+        logger_parse_format(fmt, &logger.formats[logger.num_formats]) == 0) {
+        id = logger.num_formats++;
+    }
+    if (!atomic_load_explicit(&logger.format_keys[idx], memory_order_relaxed)) {
+        logger.format_ids[idx] = id; // Cache failures too, so the parse is not repeated
+        atomic_store_explicit(&logger.format_keys[idx], fmt, memory_order_release);
+    }
+    pthread_mutex_unlock(&logger.mutex);
+    return id;
+}
+
+static void logbin_put(char *out, size_t *off, const void *v, size_t n) {
+    memcpy(out + *off, v, n);
+    *off += n;
+}
+
+/* Packs a record for format id into out (LOGGER_LINE_MAX bytes); returns its size */
+static int logger_encode(char *out, log_level_t level, int id, va_list args) {
+    const struct log_format *f = &logger.formats[id];
+    size_t off = sizeof(struct logbin_hdr);
+    size_t budget = LOGGER_LINE_MAX - off - f->fixed_bytes; // Shared by the string arguments
+    for (int i = 0; i < f->nargs; i++) {
+        switch (f->types[i]) {
+        case LOGBIN_ARG_INT32: {
+            int32_t v = va_arg(args, int);
+            logbin_put(out, &off, &v, sizeof(v));
+            break;
+        }
+        case LOGBIN_ARG_INT64: {
+            int64_t v = va_arg(args, long long);
+            logbin_put(out, &off, &v, sizeof(v));
+            break;
+        }
+        case LOGBIN_ARG_DOUBLE: {
+            double v = va_arg(args, double);
+            logbin_put(out, &off, &v, sizeof(v));
+            break;
+        }
+        case LOGBIN_ARG_PTR: {
+            uint64_t v = (uintptr_t)va_arg(args, void *);
+            logbin_put(out, &off, &v, sizeof(v));
+            break;
+        }
+        default: {
+            const char *str = va_arg(args, const char *);
+            if (!str) str = "(null)";
+            uint16_t n = strnlen(str, budget);
+            budget -= n;
+            logbin_put(out, &off, &n, sizeof(n));
+            logbin_put(out, &off, str, n);
+            break;
+        }
+        }
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    struct logbin_hdr hdr = {
+        .type = LOGBIN_RECORD, .level = level, .len = off - sizeof(hdr), .id = id,
+        .ts_ns = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec,
+    };
+    memcpy(out, &hdr, sizeof(hdr));
+    return off;
+}
+
+static int logger_encode_args(char *out, log_level_t level, int id, ...) {
+    va_list args;
+    va_start(args, id);
+    int len = logger_encode(out, level, id, args);
+    va_end(args);
+    return len;
+}
+
+/* Emits the definition of format id; returns its size */
+static size_t logger_format_record(char *out, int id) {
+    const struct log_format *f = &logger.formats[id];
+    size_t fmt_len = strlen(f->fmt) + 1;
+    struct logbin_hdr hdr = { .type = LOGBIN_FORMAT, .len = 1 + f->nargs + fmt_len, .id = id };
+    size_t off = 0;
+    logbin_put(out, &off, &hdr, sizeof(hdr));
+    logbin_put(out, &off, &f->nargs, 1);
+    logbin_put(out, &off, f->types, f->nargs);
+    logbin_put(out, &off, f->fmt, fmt_len);
+    return off;
+}
+
+static size_t logger_session_record(char *out) {
+    struct timespec mono, real;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+    struct logbin_session session = { .magic = LOGBIN_MAGIC };
+    session.realtime_ns = (int64_t)real.tv_sec * 1000000000 + real.tv_nsec;
+    struct logbin_hdr hdr = {
+        .type = LOGBIN_SESSION, .len = sizeof(session),
+        .ts_ns = (uint64_t)mono.tv_sec * 1000000000ull + mono.tv_nsec,
+    };
+    size_t off = 0;
+    logbin_put(out, &off, &hdr, sizeof(hdr));
+    logbin_put(out, &off, &session, sizeof(session));
+    return off;
+}
+
+/* Writer output; in segment mode a binary segment opened here first restates what the batch relies on */
+static void logger_output(const char *buf, size_t len, const uint8_t *defined) {
+    if (!logger.segment_size) {
+        logger_write_all(buf, len);
+        return;
+    }
+    int fresh = logger.seg_fd < 0 || logger.seg_used + len > logger.segment_size;
+    if (logger_segment_rotate(len) != 0) return;
+    if (fresh && logger.binary) {
+        char rec[sizeof(struct logbin_hdr) + 1 + LOGBIN_MAX_ARGS + LOGGER_FORMAT_MAX];
+        logger_segment_write(rec, logger_session_record(rec));
+        for (int id = 0; id < LOGGER_MAX_FORMATS; id++)
+            if (defined[id]) logger_segment_write(rec, logger_format_record(rec, id));
+    }
+    logger_segment_write(buf, len);
+}
+
+static void *logger_writer(void *arg) {
+    (void)arg;
+    static char batch[LOGGER_BATCH_MAX];
+    size_t len = 0;
+    unsigned long read_pos = 0;
+    uint64_t reported = 0; // Drops already noted in the log
+    time_t cached_sec = -1;
+    char cached[32];
+    uint8_t defined[LOGGER_MAX_FORMATS] = { 0 }; // Binary: format records already written
+    struct timespec last_flush;
+    clock_gettime(CLOCK_MONOTONIC, &last_flush);
+    if (logger.binary) len = logger_session_record(batch);
+
+    for (;;) {
+        int stopping = atomic_load(&logger.stop);
+        int urgent = 0;
+        uint64_t dropped = atomic_load_explicit(&logger.dropped, memory_order_relaxed);
+        if (dropped != reported && logger.binary) {
+            struct logbin_hdr hdr = { .type = LOGBIN_DROPPED, .level = LOG_WARNING, .id = dropped - reported };
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            hdr.ts_ns = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+            logbin_put(batch, &len, &hdr, sizeof(hdr));
+            reported = dropped;
+        } else if (dropped != reported) {
+            len += logger_prefix(batch + len, sizeof(batch) - len, time(NULL), LOG_WARNING, &cached_sec, cached);
+            len += snprintf(batch + len, sizeof(batch) - len, "Logger dropped %llu messages\n",
+                            (unsigned long long)(dropped - reported));
+            reported = dropped;
+        }
+        for (;;) {
+            struct log_slot *slot = &logger.slots[read_pos & logger.mask];
+            if (atomic_load_explicit(&slot->seq, memory_order_acquire) != read_pos + 1) break;
+            if (len + LOGGER_LINE_MAX + LOGGER_FORMAT_MAX + 64 > sizeof(batch)) {
+                logger_output(batch, len, defined);
+                len = 0;
+            }
+            if (logger.binary) {
+                struct logbin_hdr hdr;
+                memcpy(&hdr, slot->text, sizeof(hdr));
+                if (!defined[hdr.id]) {
+                    len += logger_format_record(batch + len, hdr.id);
+                    defined[hdr.id] = 1;
+                }
+                memcpy(batch + len, slot->text, slot->len);
+                len += slot->len;
+            } else {
+                len += logger_prefix(batch + len, sizeof(batch) - len, slot->sec, slot->level, &cached_sec, cached);
+                memcpy(batch + len, slot->text, slot->len);
+                len += slot->len;
+                batch[len++] = '\n';
+            }
+            if (slot->level == LOG_ERROR) urgent = 1;
+            atomic_store_explicit(&slot->seq, read_pos + logger.mask + 1, memory_order_release);
+            read_pos++;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsed_ms = (now.tv_sec - last_flush.tv_sec) * 1000 + (now.tv_nsec - last_flush.tv_nsec) / 1000000;
+        if (len > 0 && (urgent || stopping || len >= (size_t)logger.flush_bytes || elapsed_ms >= logger.flush_interval_ms)) {
+            logger_output(batch, len, defined);
+            len = 0;
+            last_flush = now;
+        }
+        if (stopping) break;
+
+        /* Sleep until notified or the next time watermark; recheck the ring after announcing */
+        int word = atomic_load(&logger.wake);
+        atomic_store(&logger.writer_waiting, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        struct log_slot *slot = &logger.slots[read_pos & logger.mask];
+        if (atomic_load(&slot->seq) != read_pos + 1 && !atomic_load(&logger.stop)) {
+            struct timespec ts;
+            deadline_from_ms(&ts, logger.flush_interval_ms);
+            futex_wait(&logger.wake, word, &ts);
+        }
+        atomic_store(&logger.writer_waiting, 0);
+    }
+    return NULL;
+}
+
 int logger_init(const char *filename) {
+    return logger_init_attr(filename, NULL);
+}
+
+int logger_init_attr(const char *filename, const struct logger_attr *attr) {
     pthread_mutex_init(&logger.mutex, NULL);
-    logger.level = LOG_INFO;
-    logger.log_file = fopen(filename, "a");
-    if (!logger.log_file) {
+    atomic_store(&logger_level, LOG_INFO);
+    logger.async = 0;
+    logger.binary = attr && attr->binary;
+    logger.segment_size = 0;
+    logger.seg_fd = -1;
+    logger.map = NULL;
+    if (attr && attr->segment_size > 0) {
+        if (strlen(filename) >= sizeof(logger.path)) {
+            pthread_mutex_destroy(&logger.mutex);
+            return -ENAMETOOLONG;
+        }
+        strcpy(logger.path, filename);
+        size_t size = attr->segment_size < LOGGER_MIN_SEGMENT ? LOGGER_MIN_SEGMENT : attr->segment_size;
+        logger.segment_size = (size + LOGGER_MAP_WINDOW - 1) / LOGGER_MAP_WINDOW * LOGGER_MAP_WINDOW;
+        logger.max_segments = attr->max_segments > 0 ? attr->max_segments : LOGGER_DEFAULT_SEGMENTS;
+        if (!logger.binary) logger_segment_trim(filename); // Binary padding decodes as empty records
+        int ret = logger_segment_open();
+        if (ret != 0) {
+            fprintf(stderr, "Failed to open log segment %s: %s\n", filename, strerror(-ret));
+            logger_segment_close();
+            logger.segment_size = 0;
+            pthread_mutex_destroy(&logger.mutex);
+            return ret;
+        }
+    } else if (!(logger.log_file = fopen(filename, "a"))) {
         fprintf(stderr, "Failed to open log file %s: %s\n", filename, strerror(errno));
         pthread_mutex_destroy(&logger.mutex);
         return -1;
-    }
-    if (fileno(logger.log_file) < 0) {
+    } else if (fileno(logger.log_file) < 0) {
         fclose(logger.log_file);
+        logger.log_file = NULL;
         pthread_mutex_destroy(&logger.mutex);
-        logger_log(LOG_ERROR, "Invalid file descriptor for log file");
+        fprintf(stderr, "Invalid file descriptor for log file\n");
         return -EBADF;
     }
-    logger_log(LOG_INFO, "Logger initialized with file %s", filename);
+    if (logger.binary) {
+        logger_parse_format("%s", &logger.formats[0]);
+        logger.num_formats = 1;
+        for (int i = 0; i < LOGGER_FORMAT_SLOTS; i++) atomic_init(&logger.format_keys[i], NULL);
+    }
+    if (attr && (attr->async || attr->binary)) {
+        unsigned long capacity = 1;
+        unsigned long size = attr->ring_size > 0 ? attr->ring_size : LOGGER_DEFAULT_RING;
+        while (capacity < size) capacity <<= 1;
+        logger.slots = aligned_alloc(CACHE_LINE_SIZE, capacity * sizeof(struct log_slot));
+        if (!logger.slots) {
+            fprintf(stderr, "Failed to allocate log ring\n");
+            logger_close_output();
+            pthread_mutex_destroy(&logger.mutex);
+            return -ENOMEM;
+        }
+        for (unsigned long i = 0; i < capacity; i++) atomic_init(&logger.slots[i].seq, i);
+        logger.mask = capacity - 1;
+        logger.flush_bytes = attr->flush_bytes > 0 ? attr->flush_bytes : LOGGER_DEFAULT_FLUSH_BYTES;
+        if (logger.flush_bytes > LOGGER_BATCH_MAX / 2) logger.flush_bytes = LOGGER_BATCH_MAX / 2;
+        logger.flush_interval_ms = attr->flush_interval_ms > 0 ? attr->flush_interval_ms : LOGGER_DEFAULT_FLUSH_MS;
+        atomic_init(&logger.stop, 0);
+        atomic_init(&logger.dropped, 0);
+        atomic_init(&logger.write_pos, 0);
+        atomic_init(&logger.wake, 0);
+        atomic_init(&logger.writer_waiting, 0);
+        if (pthread_create(&logger.writer, NULL, logger_writer, NULL) != 0) {
+            fprintf(stderr, "Failed to create log writer thread\n");
+            free(logger.slots);
+            logger.slots = NULL;
+            logger_close_output();
+            pthread_mutex_destroy(&logger.mutex);
+            return -EAGAIN;
+        }
+        logger.async = 1;
+    }
+    logger_log(LOG_INFO, "Logger initialized with file %s%s", filename,
+               logger.binary ? " (binary)" : logger.async ? " (async)" : "");
     return 0;
 }
 
 void logger_destroy(void) {
-    pthread_mutex_lock(&logger.mutex);
-    if (logger.log_file) {
-        logger_log(LOG_INFO, "Logger shutting down");
-        fclose(logger.log_file);
-        logger.log_file = NULL;
+    logger_log(LOG_INFO, "Logger shutting down");
+    if (logger.async) {
+        atomic_store(&logger.stop, 1);
+        atomic_fetch_add(&logger.wake, 1);
+        futex_wake(&logger.wake, 1);
+        pthread_join(logger.writer, NULL);
+        logger.async = 0;
+        free(logger.slots);
+        logger.slots = NULL;
     }
+    pthread_mutex_lock(&logger.mutex);
+    logger_close_output();
     pthread_mutex_unlock(&logger.mutex);
     pthread_mutex_destroy(&logger.mutex);
 }
@@ -57,30 +624,87 @@ void logger_set_level(log_level_t level) {
         logger_log(LOG_ERROR, "Invalid log level: %d", level);
         return;
     }
-    pthread_mutex_lock(&logger.mutex);
-    logger.level = level;
+    atomic_store_explicit(&logger_level, level, memory_order_relaxed);
     logger_log(LOG_INFO, "Log level set to %s", log_level_str[level]);
-    pthread_mutex_unlock(&logger.mutex);
+}
+
+static void logger_log_async(log_level_t level, const char *format, va_list args) {
+    int id = logger.binary ? logger_format_id(format) : 0; // Before claiming, registration may lock
+    unsigned long pos = atomic_load_explicit(&logger.write_pos, memory_order_relaxed);
+    struct log_slot *slot;
+    int tries = 0;
+    for (;;) {
+        slot = &logger.slots[pos & logger.mask];
+        long diff = (long)atomic_load_explicit(&slot->seq, memory_order_acquire) - (long)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&logger.write_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            if (level == LOG_ERROR && tries++ < LOGGER_ERROR_RETRIES) {
+                logger_notify(); // Errors are worth a short wait for the writer to make room
+                sched_yield();
+                pos = atomic_load_explicit(&logger.write_pos, memory_order_relaxed);
+                continue;
+            }
+            atomic_fetch_add_explicit(&logger.dropped, 1, memory_order_relaxed); // Full: never block the caller
+            return;
+        } else {
+            pos = atomic_load_explicit(&logger.write_pos, memory_order_relaxed);
+        }
+    }
+    slot->level = level;
+    if (!logger.binary) {
+        slot->sec = time(NULL);
+        int len = vsnprintf(slot->text, sizeof(slot->text), format, args);
+        slot->len = len < 0 ? 0 : len >= (int)sizeof(slot->text) ? (int)sizeof(slot->text) - 1 : len;
+    } else if (id >= 0) {
+        slot->len = logger_encode(slot->text, level, id, args);
+    } else {
+        /* Cannot be replayed from raw arguments: store it preformatted under "%s" */
+        char line[LOGGER_LINE_MAX];
+        vsnprintf(line, sizeof(line), format, args);
+        slot->len = logger_encode_args(slot->text, level, 0, line);
+    }
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    if (level == LOG_ERROR || ((pos + 1) & (logger.mask >> 1)) == 0) logger_notify();
 }
 
 void logger_log(log_level_t level, const char *format, ...) {
-    if (level < logger.level) return;
+    if (!logger_enabled(level)) return;
+
+    va_list args;
+    va_start(args, format);
+    if (logger.async) {
+        logger_log_async(level, format, args);
+        va_end(args);
+        return;
+    }
 
+    char prefix[64];
+    int prefix_len = logger_prefix(prefix, sizeof(prefix), time(NULL), level, &tls_stamp_sec, tls_stamp);
+    if (logger.segment_size) {
+        /* Format outside the lock; under it the line is only copied into the mapping */
+        char line[sizeof(prefix) + LOGGER_LINE_MAX];
+        memcpy(line, prefix, prefix_len);
+        int len = vsnprintf(line + prefix_len, LOGGER_LINE_MAX, format, args);
+        len = prefix_len + (len < 0 ? 0 : len >= LOGGER_LINE_MAX ? LOGGER_LINE_MAX - 1 : len);
+        line[len++] = '\n';
+        va_end(args);
+        pthread_mutex_lock(&logger.mutex);
+        if (logger.segment_size && logger_segment_rotate(len) == 0) logger_segment_write(line, len);
+        pthread_mutex_unlock(&logger.mutex);
+        return;
+    }
     pthread_mutex_lock(&logger.mutex);
     if (!logger.log_file) {
         pthread_mutex_unlock(&logger.mutex);
         fprintf(stderr, "Log file not initialized\n");
+        va_end(args);
         return;
     }
 
-    char timestamp[32];
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
-
-    va_list args;
-    va_start(args, format);
-    fprintf(logger.log_file, "[%s] [%s] ", timestamp, log_level_str[level]);
+    fputs(prefix, logger.log_file);
     vfprintf(logger.log_file, format, args);
     fprintf(logger.log_file, "\n");
     if (fflush(logger.log_file) != 0 || ferror(logger.log_file)) {
@@ -91,4 +715,8 @@ void logger_log(log_level_t level, const char *format, ...) {
     }
     va_end(args);
     pthread_mutex_unlock(&logger.mutex);
-}
\ No newline at end of file
+}
+
+uint64_t logger_dropped(void) {
+    return atomic_load_explicit(&logger.dropped, memory_order_relaxed);
+}
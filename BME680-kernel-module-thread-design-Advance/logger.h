@@ -1,6 +1,10 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
 typedef enum {
     LOG_DEBUG,
     LOG_INFO,
@@ -8,9 +12,56 @@ typedef enum {
     LOG_ERROR
 } log_level_t;
 
+#define LOGGER_LINE_MAX 256 // Longer messages are truncated
+
+/*
+ * Levels below LOG_MIN_LEVEL (0 = DEBUG ... 3 = ERROR, set with -DLOG_MIN_LEVEL=n) are
+ * removed at compile time: LOGD() and friends then compile to nothing and their arguments
+ * are never evaluated. Enabled levels are filtered by an inline load of the runtime level,
+ * so a filtered call costs neither a function call nor argument evaluation.
+ */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+extern atomic_int logger_level; // Set through logger_set_level()
+
+static inline int logger_enabled(log_level_t level) {
+    return (int)level >= LOG_MIN_LEVEL && (int)level >= atomic_load_explicit(&logger_level, memory_order_relaxed);
+}
+
+#define LOG_AT(level, ...) \
+    do { \
+        if (logger_enabled(level)) logger_log(level, __VA_ARGS__); \
+    } while (0)
+#define LOGD(...) LOG_AT(LOG_DEBUG, __VA_ARGS__)
+#define LOGI(...) LOG_AT(LOG_INFO, __VA_ARGS__)
+#define LOGW(...) LOG_AT(LOG_WARNING, __VA_ARGS__)
+#define LOGE(...) LOG_AT(LOG_ERROR, __VA_ARGS__)
+
+struct logger_attr {
+    int async;             // Callers only format into a lock-free ring; a writer thread batches the I/O
+    int ring_size;         // Async: lines buffered, rounded up to a power of two; 0 selects 4096
+    int flush_bytes;       // Async: write once this much is batched; 0 selects 32 KiB
+    int flush_interval_ms; // Async: ...or once this much time has passed; 0 selects 200 ms
+    int binary;            // Implies async: store format ids and raw arguments, decode with bme680_logdump
+    size_t segment_size;   // Rotate through preallocated, mmap-written segments of this size (min 2 MiB); 0 appends
+    int max_segments;      // Segments kept: filename, filename.1, ... up to max_segments - 1; 0 selects 4
+};
+
 int logger_init(const char *filename);
+/* attr may be NULL (synchronous, one flushed write per line) */
+int logger_init_attr(const char *filename, const struct logger_attr *attr);
+/* Async: writes out everything logged so far before closing */
 void logger_destroy(void);
 void logger_set_level(log_level_t level);
+/*
+ * Async: queues the line for the writer thread. If the ring is full, lines below ERROR are
+ * dropped at once, while an ERROR line yields (up to 10000 times) waiting for space before
+ * it is dropped. Queuing an ERROR line wakes the writer. Prefer the LOG* macros.
+ */
 void logger_log(log_level_t level, const char *format, ...);
+/* Async lines lost because the ring was full */
+uint64_t logger_dropped(void);
 
-#endif /* LOGGER_H */
\ No newline at end of file
+#endif /* LOGGER_H */
@@ -0,0 +1,50 @@
+#ifndef LOGGER_BINARY_H
+#define LOGGER_BINARY_H
+
+#include <stdint.h>
+
+/*
+ * On-disk layout of binary logs, shared by logger.c and bme680_logdump.c. A file is a
+ * sequence of records in host byte order, each starting with struct logbin_hdr:
+ *
+ *   SESSION  written once per logger_init(); payload is struct logbin_session. Format
+ *            ids restart from 0 after it.
+ *   FORMAT   defines format id hdr.id before its first use; payload is uint8_t nargs,
+ *            nargs logbin_arg types, then the NUL-terminated format string.
+ *   RECORD   one logger_log() call; payload is the raw arguments in format order:
+ *            INT32 4 bytes, INT64/DOUBLE/PTR 8 bytes, STRING uint16_t length + bytes.
+ *   DROPPED  hdr.id lines were lost because the ring was full.
+ */
+
+#define LOGBIN_MAGIC "BMELOG1"
+#define LOGBIN_MAX_ARGS 16
+
+enum logbin_type {
+    LOGBIN_SESSION = 1,
+    LOGBIN_FORMAT,
+    LOGBIN_RECORD,
+    LOGBIN_DROPPED
+};
+
+enum logbin_arg {
+    LOGBIN_ARG_INT32 = 1, // int and everything promoted to it, '*' width/precision
+    LOGBIN_ARG_INT64,     // l/ll/z/j/t when 64-bit
+    LOGBIN_ARG_DOUBLE,
+    LOGBIN_ARG_STRING,
+    LOGBIN_ARG_PTR
+};
+
+struct logbin_hdr {
+    uint8_t type;
+    uint8_t level;
+    uint16_t len;   // Payload bytes following the header
+    uint32_t id;
+    uint64_t ts_ns; // CLOCK_MONOTONIC
+};
+
+struct logbin_session {
+    char magic[8];
+    int64_t realtime_ns; // CLOCK_REALTIME at hdr.ts_ns
+};
+
+#endif /* LOGGER_BINARY_H */
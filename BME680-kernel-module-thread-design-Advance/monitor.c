@@ -7,8 +7,24 @@
 #include "logger.h"
 #include "rwlock.h"
 #include "deadlock_detector.h"
+#include "sync_util.h"
+#include "seqlock.h"
+
+#define MONITOR_TIMEOUT_MS 5000
+#define MONITOR_SPIN 100 // Polls before parking on an empty/full ring
+
+struct monitor_slot {
+    atomic_ulong seq; // MPMC only: tells producers and consumers whose turn the slot is
+    struct bme680_fifo_data data;
+};
+
+SEQLOCK_CELL(monitor_latest, struct bme680_fifo_data)
 
 struct bme680_monitor {
+    enum bme680_monitor_mode mode;
+    enum bme680_monitor_overflow overflow;
+    atomic_ullong dropped;
+    /* Locked mode */
     struct bme680_fifo_data *data;
     int head;
     int tail;
@@ -19,17 +35,273 @@ struct bme680_monitor {
     pthread_cond_t not_empty;
     rwlock_t rwlock;
     deadlock_detector_t *dd;
+    /* Ring modes: cursors and futex words on separate cache lines */
+    struct monitor_slot *slots;
+    unsigned long mask;
+    _Alignas(CACHE_LINE_SIZE) atomic_ulong read_pos; // Next slot to read
+    _Alignas(CACHE_LINE_SIZE) atomic_ulong write_pos; // Next slot to write
+    _Alignas(CACHE_LINE_SIZE) atomic_int readable; // Futex word, bumped when a reader may be sleeping
+    atomic_int read_waiters;
+    _Alignas(CACHE_LINE_SIZE) atomic_int writable;
+    atomic_int write_waiters;
+    _Alignas(CACHE_LINE_SIZE) struct monitor_latest latest; // Last sample written, for bme680_monitor_latest()
 };
 
+static int monitor_validate(const struct bme680_fifo_data *data) {
+    if (data->temp < -40 || data->temp > 85 || data->pressure < 30000 || data->pressure > 110000 || data->humidity < 0 || data->humidity > 100) {
+        LOGE("Invalid sensor data: temp=%f, pressure=%u, humidity=%u", data->temp, data->pressure, data->humidity);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static int monitor_write_lossy(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int n);
+
+static int monitor_ring_init(struct bme680_monitor *monitor, int size) {
+    unsigned long capacity = 1;
+    while (capacity < (unsigned long)size) capacity <<= 1;
+    monitor->slots = aligned_alloc(CACHE_LINE_SIZE, capacity * sizeof(struct monitor_slot));
+    if (!monitor->slots) return -ENOMEM;
+    for (unsigned long i = 0; i < capacity; i++) {
+        atomic_init(&monitor->slots[i].seq, i);
+    }
+    monitor->mask = capacity - 1;
+    monitor->size = (int)capacity;
+    atomic_init(&monitor->read_pos, 0);
+    atomic_init(&monitor->write_pos, 0);
+    atomic_init(&monitor->readable, 0);
+    atomic_init(&monitor->read_waiters, 0);
+    atomic_init(&monitor->writable, 0);
+    atomic_init(&monitor->write_waiters, 0);
+    return 0;
+}
+
+/* Claim up to n free slots in one step; returns the number written */
+static int monitor_ring_try_push(struct bme680_monitor *monitor, const struct bme680_fifo_data *data, int n) {
+    if (monitor->mode == BME680_MONITOR_SPSC) {
+        unsigned long tail = atomic_load_explicit(&monitor->write_pos, memory_order_relaxed);
+        unsigned long free_slots = monitor->mask + 1 - (tail - atomic_load_explicit(&monitor->read_pos, memory_order_acquire));
+        int k = (unsigned long)n < free_slots ? n : (int)free_slots;
+        for (int i = 0; i < k; i++) {
+            monitor->slots[(tail + i) & monitor->mask].data = data[i];
+        }
+        if (k > 0) atomic_store_explicit(&monitor->write_pos, tail + k, memory_order_release);
+        return k;
+    }
+    unsigned long pos = atomic_load_explicit(&monitor->write_pos, memory_order_relaxed);
+    for (;;) {
+        int k = 0;
+        long diff = 0;
+        while (k < n) {
+            unsigned long seq = atomic_load_explicit(&monitor->slots[(pos + k) & monitor->mask].seq, memory_order_acquire);
+            diff = (long)seq - (long)(pos + k);
+            if (diff != 0) break;
+            k++;
+        }
+        if (k == 0) {
+            if (diff < 0) return 0; // Full
+            pos = atomic_load_explicit(&monitor->write_pos, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&monitor->write_pos, &pos, pos + k,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            for (int i = 0; i < k; i++) {
+                struct monitor_slot *slot = &monitor->slots[(pos + i) & monitor->mask];
+                slot->data = data[i];
+                atomic_store_explicit(&slot->seq, pos + i + 1, memory_order_release);
+            }
+            return k;
+        }
+    }
+}
+
+/* Claim up to max filled slots in one step; returns the number read */
+static int monitor_ring_try_pop(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int max) {
+    if (monitor->mode == BME680_MONITOR_SPSC) {
+        unsigned long head = atomic_load_explicit(&monitor->read_pos, memory_order_relaxed);
+        unsigned long avail = atomic_load_explicit(&monitor->write_pos, memory_order_acquire) - head;
+        int k = (unsigned long)max < avail ? max : (int)avail;
+        for (int i = 0; i < k; i++) {
+            data[i] = monitor->slots[(head + i) & monitor->mask].data;
+        }
+        if (k > 0) atomic_store_explicit(&monitor->read_pos, head + k, memory_order_release);
+        return k;
+    }
+    unsigned long pos = atomic_load_explicit(&monitor->read_pos, memory_order_relaxed);
+    for (;;) {
+        int k = 0;
+        long diff = 0;
+        while (k < max) {
+            unsigned long seq = atomic_load_explicit(&monitor->slots[(pos + k) & monitor->mask].seq, memory_order_acquire);
+            diff = (long)seq - (long)(pos + k + 1);
+            if (diff != 0) break;
+            k++;
+        }
+        if (k == 0) {
+            if (diff < 0) return 0; // Empty
+            pos = atomic_load_explicit(&monitor->read_pos, memory_order_relaxed);
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&monitor->read_pos, &pos, pos + k,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            for (int i = 0; i < k; i++) {
+                struct monitor_slot *slot = &monitor->slots[(pos + i) & monitor->mask];
+                data[i] = slot->data;
+                atomic_store_explicit(&slot->seq, pos + i + monitor->mask + 1, memory_order_release);
+            }
+            return k;
+        }
+    }
+}
+
+/* Wake up to count sleepers on word; the fence pairs with the one in monitor_ring_wait() */
+static void monitor_ring_notify(atomic_int *word, atomic_int *waiters, int count) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(waiters, memory_order_relaxed) > 0) {
+        atomic_fetch_add(word, 1);
+        futex_wake(word, count);
+    }
+}
+
+/* Progress of a (batch) transfer; done counts samples moved so far */
+struct monitor_xfer {
+    struct bme680_fifo_data *buf;
+    int max;
+    int min;
+    int done;
+};
+
+/* Each step notifies the other side as soon as anything moved, so partial batches never stall it */
+static int monitor_ring_push_step(struct bme680_monitor *monitor, struct monitor_xfer *x) {
+    int k = monitor_ring_try_push(monitor, x->buf + x->done, x->max - x->done);
+    if (k > 0) {
+        x->done += k;
+        monitor_ring_notify(&monitor->readable, &monitor->read_waiters, k);
+    }
+    return x->done >= x->min ? 0 : -EAGAIN;
+}
+
+static int monitor_ring_pop_step(struct bme680_monitor *monitor, struct monitor_xfer *x) {
+    int k = monitor_ring_try_pop(monitor, x->buf + x->done, x->max - x->done);
+    if (k > 0) {
+        x->done += k;
+        monitor_ring_notify(&monitor->writable, &monitor->write_waiters, k);
+    }
+    return x->done >= x->min ? 0 : -EAGAIN;
+}
+
+/*
+ * Run step until it reports completion: spin a little, then sleep on word. The word is sampled
+ * before registering as a waiter and step is retried after, so a notify in between is never lost.
+ * timeout_ms < 0 waits forever, 0 only tries once.
+ */
+static int monitor_ring_wait(struct bme680_monitor *monitor, atomic_int *word, atomic_int *waiters,
+                             int (*step)(struct bme680_monitor *, struct monitor_xfer *),
+                             struct monitor_xfer *x, int timeout_ms) {
+    struct timespec ts;
+    int have_deadline = 0;
+    if (step(monitor, x) == 0) return 0;
+    if (timeout_ms == 0) return -ETIMEDOUT;
+    for (int spin = 0;; spin++) {
+        if (spin < MONITOR_SPIN) {
+            cpu_relax();
+            if (step(monitor, x) == 0) return 0;
+            continue;
+        }
+        if (!have_deadline && timeout_ms > 0) {
+            deadline_from_ms(&ts, timeout_ms);
+            have_deadline = 1;
+        }
+        int seq = atomic_load(word);
+        atomic_fetch_add(waiters, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (step(monitor, x) == 0) {
+            atomic_fetch_sub(waiters, 1);
+            return 0;
+        }
+        int ret = futex_wait(word, seq, have_deadline ? &ts : NULL);
+        atomic_fetch_sub(waiters, 1);
+        if (ret == -ETIMEDOUT) return step(monitor, x) == 0 ? 0 : -ETIMEDOUT;
+    }
+}
+
+static int monitor_ring_write(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int n, int timeout_ms) {
+    struct monitor_xfer x = { .buf = data, .max = n, .min = n, .done = 0 };
+    if (monitor_ring_wait(monitor, &monitor->writable, &monitor->write_waiters,
+                          monitor_ring_push_step, &x, timeout_ms) != 0) {
+        LOGE("Monitor write timed out after %d of %d samples", x.done, n);
+        return x.done > 0 ? x.done : -ETIMEDOUT;
+    }
+    return x.done;
+}
+
+/* Never blocks: evicts the oldest samples (or, when conflating, everything pending) to make room */
+static int monitor_ring_write_lossy(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int n) {
+    struct bme680_fifo_data victims[16];
+    uint64_t dropped = 0;
+    int done = 0;
+    int k;
+
+    if (monitor->overflow == BME680_MONITOR_CONFLATE) {
+        dropped += n - 1; // Superseded within the batch itself
+        data += n - 1;
+        n = 1;
+        while ((k = monitor_ring_try_pop(monitor, victims, 16)) > 0) dropped += k;
+    }
+    while (done < n) {
+        done += monitor_ring_try_push(monitor, data + done, n - done);
+        if (done < n) dropped += monitor_ring_try_pop(monitor, victims, 1); // May lose the race to a reader; retry
+    }
+    monitor_ring_notify(&monitor->readable, &monitor->read_waiters, n);
+    if (dropped) atomic_fetch_add_explicit(&monitor->dropped, dropped, memory_order_relaxed);
+    return done;
+}
+
+static int monitor_ring_read(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int max, int min, int timeout_ms) {
+    struct monitor_xfer x = { .buf = data, .max = max, .min = min, .done = 0 };
+    if (monitor_ring_wait(monitor, &monitor->readable, &monitor->read_waiters,
+                          monitor_ring_pop_step, &x, timeout_ms) != 0)
+        return x.done > 0 ? x.done : -ETIMEDOUT;
+    return x.done;
+}
+
 int bme680_monitor_init(struct bme680_monitor **monitor, int size) {
-    *monitor = malloc(sizeof(struct bme680_monitor));
+    return bme680_monitor_init_attr(monitor, size, NULL);
+}
+
+int bme680_monitor_init_attr(struct bme680_monitor **monitor, int size, const struct bme680_monitor_attr *attr) {
+    enum bme680_monitor_mode mode = attr ? attr->mode : BME680_MONITOR_LOCKED;
+    enum bme680_monitor_overflow overflow = attr ? attr->overflow : BME680_MONITOR_BLOCK;
+    if (size <= 0 || (mode != BME680_MONITOR_LOCKED && mode != BME680_MONITOR_SPSC && mode != BME680_MONITOR_MPMC) ||
+        (overflow != BME680_MONITOR_BLOCK && overflow != BME680_MONITOR_OVERWRITE_OLDEST && overflow != BME680_MONITOR_CONFLATE)) {
+        LOGE("Invalid monitor parameters: size=%d, mode=%d, overflow=%d", size, mode, overflow);
+        return -EINVAL;
+    }
+    /* Evicting makes the producer a second consumer, which the SPSC protocol cannot express */
+    if (mode == BME680_MONITOR_SPSC && overflow != BME680_MONITOR_BLOCK) mode = BME680_MONITOR_MPMC;
+    *monitor = aligned_alloc(CACHE_LINE_SIZE, sizeof(struct bme680_monitor));
     if (!*monitor) {
-        logger_log(LOG_ERROR, "Failed to allocate monitor");
+        LOGE("Failed to allocate monitor");
         return -ENOMEM;
     }
+    memset(*monitor, 0, sizeof(struct bme680_monitor));
+    (*monitor)->mode = mode;
+    (*monitor)->overflow = overflow;
+    atomic_init(&(*monitor)->dropped, 0);
+    monitor_latest_init(&(*monitor)->latest);
+    if (mode != BME680_MONITOR_LOCKED) {
+        if (monitor_ring_init(*monitor, size) != 0) {
+            LOGE("Failed to allocate monitor ring");
+            free(*monitor);
+            return -ENOMEM;
+        }
+        LOGI("Monitor initialized with size %d (%s ring, overflow policy %d)", (*monitor)->size,
+             mode == BME680_MONITOR_SPSC ? "SPSC" : "MPMC", overflow);
+        return 0;
+    }
     (*monitor)->data = malloc(size * sizeof(struct bme680_fifo_data));
     if (!(*monitor)->data) {
-        logger_log(LOG_ERROR, "Failed to allocate monitor data");
+        LOGE("Failed to allocate monitor data");
         free(*monitor);
         return -ENOMEM;
     }
@@ -37,16 +309,26 @@ int bme680_monitor_init(struct bme680_monitor **monitor, int size) {
     (*monitor)->head = 0;
     (*monitor)->tail = 0;
     (*monitor)->count = 0;
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC); // Deadlines are CLOCK_MONOTONIC
     pthread_mutex_init(&(*monitor)->mutex, NULL);
-    pthread_cond_init(&(*monitor)->not_full, NULL);
-    pthread_cond_init(&(*monitor)->not_empty, NULL);
+    pthread_cond_init(&(*monitor)->not_full, &cattr);
+    pthread_cond_init(&(*monitor)->not_empty, &cattr);
+    pthread_condattr_destroy(&cattr);
     rwlock_init(&(*monitor)->rwlock);
     deadlock_detector_init(&(*monitor)->dd, 2); // 2 mutexes: mutex and rwlock
-    logger_log(LOG_INFO, "Monitor initialized with size %d", size);
+    LOGI("Monitor initialized with size %d (overflow policy %d)", size, overflow);
     return 0;
 }
 
 void bme680_monitor_destroy(struct bme680_monitor *monitor) {
+    if (monitor->mode != BME680_MONITOR_LOCKED) {
+        free(monitor->slots);
+        free(monitor);
+        LOGI("Monitor destroyed");
+        return;
+    }
     rwlock_wrlock(&monitor->rwlock);
     free(monitor->data);
     pthread_mutex_destroy(&monitor->mutex);
@@ -55,21 +337,29 @@ void bme680_monitor_destroy(struct bme680_monitor *monitor) {
     rwlock_destroy(&monitor->rwlock);
     deadlock_detector_destroy(monitor->dd);
     free(monitor);
-    logger_log(LOG_INFO, "Monitor destroyed");
+    LOGI("Monitor destroyed");
 }
 
 int bme680_monitor_write(struct bme680_monitor *monitor, struct bme680_fifo_data *data) {
     struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    ts.tv_sec += 5; // 5-second timeout
 
-    if (data->temp < -40 || data->temp > 85 || data->pressure < 30000 || data->pressure > 110000 || data->humidity < 0 || data->humidity > 100) {
-        logger_log(LOG_ERROR, "Invalid sensor data: temp=%f, pressure=%u, humidity=%u", data->temp, data->pressure, data->humidity);
-        return -EINVAL;
+    if (monitor_validate(data) != 0) return -EINVAL;
+    if (monitor->overflow != BME680_MONITOR_BLOCK) {
+        int ret = monitor_write_lossy(monitor, data, 1);
+        if (ret < 0) return ret;
+        monitor_latest_store(&monitor->latest, data);
+        return 0;
+    }
+    if (monitor->mode != BME680_MONITOR_LOCKED) {
+        if (monitor_ring_write(monitor, data, 1, MONITOR_TIMEOUT_MS) != 1) return -ETIMEDOUT;
+        monitor_latest_store(&monitor->latest, data);
+        return 0;
     }
 
+    deadline_from_ms(&ts, MONITOR_TIMEOUT_MS);
+
     if (deadlock_detector_lock(monitor->dd, 0) != 0) {
-        logger_log(LOG_ERROR, "Potential deadlock detected during monitor write");
+        LOGE("Potential deadlock detected during monitor write");
         return -EDEADLK;
     }
     pthread_mutex_lock(&monitor->mutex);
@@ -78,20 +368,20 @@ int bme680_monitor_write(struct bme680_monitor *monitor, struct bme680_fifo_data
         if (ret == ETIMEDOUT) {
             pthread_mutex_unlock(&monitor->mutex);
             deadlock_detector_unlock(monitor->dd, 0);
-            logger_log(LOG_ERROR, "Monitor write timed out");
+            LOGE("Monitor write timed out");
             return -ETIMEDOUT;
         }
         if (ret != 0) {
             pthread_mutex_unlock(&monitor->mutex);
             deadlock_detector_unlock(monitor->dd, 0);
-            logger_log(LOG_ERROR, "Monitor write wait failed: %s", strerror(ret));
+            LOGE("Monitor write wait failed: %s", strerror(ret));
             return ret;
         }
     }
     if (monitor->count < 0 || monitor->count > monitor->size) {
         pthread_mutex_unlock(&monitor->mutex);
         deadlock_detector_unlock(monitor->dd, 0);
-        logger_log(LOG_ERROR, "Invalid monitor count: %d", monitor->count);
+        LOGE("Invalid monitor count: %d", monitor->count);
         return -EINVAL;
     }
     rwlock_wrlock(&monitor->rwlock);
@@ -102,17 +392,24 @@ int bme680_monitor_write(struct bme680_monitor *monitor, struct bme680_fifo_data
     rwlock_unlock(&monitor->rwlock);
     pthread_mutex_unlock(&monitor->mutex);
     deadlock_detector_unlock(monitor->dd, 0);
-    logger_log(LOG_DEBUG, "Monitor write: count=%d", monitor->count);
+    monitor_latest_store(&monitor->latest, data);
+    LOGD("Monitor write: count=%d", monitor->count);
     return 0;
 }
 
 int bme680_monitor_read(struct bme680_monitor *monitor, struct bme680_fifo_data *data) {
     struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    ts.tv_sec += 5; // 5-second timeout
+
+    if (monitor->mode != BME680_MONITOR_LOCKED) {
+        if (monitor_ring_read(monitor, data, 1, 1, MONITOR_TIMEOUT_MS) == 1) return 0;
+        LOGE("Monitor read timed out");
+        return -ETIMEDOUT;
+    }
+
+    deadline_from_ms(&ts, MONITOR_TIMEOUT_MS);
 
     if (deadlock_detector_lock(monitor->dd, 1) != 0) {
-        logger_log(LOG_ERROR, "Potential deadlock detected during monitor read");
+        LOGE("Potential deadlock detected during monitor read");
         return -EDEADLK;
     }
     pthread_mutex_lock(&monitor->mutex);
@@ -121,20 +418,20 @@ int bme680_monitor_read(struct bme680_monitor *monitor, struct bme680_fifo_data
         if (ret == ETIMEDOUT) {
             pthread_mutex_unlock(&monitor->mutex);
             deadlock_detector_unlock(monitor->dd, 1);
-            logger_log(LOG_ERROR, "Monitor read timed out");
+            LOGE("Monitor read timed out");
             return -ETIMEDOUT;
         }
         if (ret != 0) {
             pthread_mutex_unlock(&monitor->mutex);
             deadlock_detector_unlock(monitor->dd, 1);
-            logger_log(LOG_ERROR, "Monitor read wait failed: %s", strerror(ret));
+            LOGE("Monitor read wait failed: %s", strerror(ret));
             return ret;
         }
     }
     if (monitor->count < 0 || monitor->count > monitor->size) {
         pthread_mutex_unlock(&monitor->mutex);
         deadlock_detector_unlock(monitor->dd, 1);
-        logger_log(LOG_ERROR, "Invalid monitor count: %d", monitor->count);
+        LOGE("Invalid monitor count: %d", monitor->count);
         return -EINVAL;
     }
     rwlock_rdlock(&monitor->rwlock);
@@ -145,6 +442,151 @@ int bme680_monitor_read(struct bme680_monitor *monitor, struct bme680_fifo_data
     rwlock_unlock(&monitor->rwlock);
     pthread_mutex_unlock(&monitor->mutex);
     deadlock_detector_unlock(monitor->dd, 1);
-    logger_log(LOG_DEBUG, "Monitor read: count=%d", monitor->count);
+    LOGD("Monitor read: count=%d", monitor->count);
     return 0;
-}
\ No newline at end of file
+}
+
+/* Locked mode counterpart of monitor_ring_write_lossy() */
+static int monitor_locked_write_lossy(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int n) {
+    uint64_t dropped = 0;
+
+    if (deadlock_detector_lock(monitor->dd, 0) != 0) {
+        LOGE("Potential deadlock detected during monitor write");
+        return -EDEADLK;
+    }
+    pthread_mutex_lock(&monitor->mutex);
+    rwlock_wrlock(&monitor->rwlock);
+    if (monitor->overflow == BME680_MONITOR_CONFLATE) {
+        dropped += n - 1 + monitor->count;
+        data += n - 1;
+        n = 1;
+        monitor->head = monitor->tail;
+        monitor->count = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        if (monitor->count == monitor->size) {
+            monitor->head = (monitor->head + 1) % monitor->size;
+            monitor->count--;
+            dropped++;
+        }
+        monitor->data[monitor->tail] = data[i];
+        monitor->tail = (monitor->tail + 1) % monitor->size;
+        monitor->count++;
+    }
+    pthread_cond_broadcast(&monitor->not_empty);
+    rwlock_unlock(&monitor->rwlock);
+    pthread_mutex_unlock(&monitor->mutex);
+    deadlock_detector_unlock(monitor->dd, 0);
+    if (dropped) atomic_fetch_add_explicit(&monitor->dropped, dropped, memory_order_relaxed);
+    return n;
+}
+
+static int monitor_write_lossy(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int n) {
+    if (monitor->mode != BME680_MONITOR_LOCKED) return monitor_ring_write_lossy(monitor, data, n);
+    return monitor_locked_write_lossy(monitor, data, n);
+}
+
+/* Locked mode batches: one lock round-trip per wakeup instead of per sample */
+static int monitor_locked_write_batch(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int n, int timeout_ms) {
+    struct timespec ts;
+    int done = 0;
+    int ret = 0;
+
+    if (timeout_ms > 0) deadline_from_ms(&ts, timeout_ms);
+    if (deadlock_detector_lock(monitor->dd, 0) != 0) {
+        LOGE("Potential deadlock detected during monitor write");
+        return -EDEADLK;
+    }
+    pthread_mutex_lock(&monitor->mutex);
+    for (;;) {
+        int k = monitor->size - monitor->count;
+        if (k > n - done) k = n - done;
+        if (k > 0) {
+            rwlock_wrlock(&monitor->rwlock);
+            for (int i = 0; i < k; i++) {
+                monitor->data[monitor->tail] = data[done + i];
+                monitor->tail = (monitor->tail + 1) % monitor->size;
+            }
+            monitor->count += k;
+            done += k;
+            pthread_cond_broadcast(&monitor->not_empty);
+            rwlock_unlock(&monitor->rwlock);
+        }
+        if (done == n || timeout_ms == 0) break;
+        ret = timeout_ms < 0 ? pthread_cond_wait(&monitor->not_full, &monitor->mutex)
+                             : pthread_cond_timedwait(&monitor->not_full, &monitor->mutex, &ts);
+        if (ret != 0) break;
+    }
+    pthread_mutex_unlock(&monitor->mutex);
+    deadlock_detector_unlock(monitor->dd, 0);
+    if (done < n) LOGE("Monitor write timed out after %d of %d samples", done, n);
+    if (done == 0) return ret && ret != ETIMEDOUT ? -ret : -ETIMEDOUT;
+    return done;
+}
+
+static int monitor_locked_read_batch(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int max, int min, int timeout_ms) {
+    struct timespec ts;
+    int ret = 0;
+
+    if (timeout_ms > 0) deadline_from_ms(&ts, timeout_ms);
+    if (deadlock_detector_lock(monitor->dd, 1) != 0) {
+        LOGE("Potential deadlock detected during monitor read");
+        return -EDEADLK;
+    }
+    pthread_mutex_lock(&monitor->mutex);
+    while (monitor->count < min && timeout_ms != 0) {
+        ret = timeout_ms < 0 ? pthread_cond_wait(&monitor->not_empty, &monitor->mutex)
+                             : pthread_cond_timedwait(&monitor->not_empty, &monitor->mutex, &ts);
+        if (ret != 0) break;
+    }
+    int k = monitor->count < max ? monitor->count : max;
+    if (k > 0) {
+        rwlock_rdlock(&monitor->rwlock);
+        for (int i = 0; i < k; i++) {
+            data[i] = monitor->data[monitor->head];
+            monitor->head = (monitor->head + 1) % monitor->size;
+        }
+        monitor->count -= k;
+        pthread_cond_broadcast(&monitor->not_full);
+        rwlock_unlock(&monitor->rwlock);
+    }
+    pthread_mutex_unlock(&monitor->mutex);
+    deadlock_detector_unlock(monitor->dd, 1);
+    if (k == 0 && min > 0) {
+        if (ret != 0 && ret != ETIMEDOUT) return -ret;
+        return -ETIMEDOUT;
+    }
+    return k;
+}
+
+int bme680_monitor_write_batch(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int n, int timeout_ms) {
+    if (!data || n <= 0) return -EINVAL;
+    for (int i = 0; i < n; i++) {
+        if (monitor_validate(&data[i]) != 0) return -EINVAL;
+    }
+    int ret;
+    if (monitor->overflow != BME680_MONITOR_BLOCK) {
+        ret = monitor_write_lossy(monitor, data, n);
+        if (ret >= 0) ret = n;
+    } else if (monitor->mode != BME680_MONITOR_LOCKED) {
+        ret = monitor_ring_write(monitor, data, n, timeout_ms);
+    } else {
+        ret = monitor_locked_write_batch(monitor, data, n, timeout_ms);
+    }
+    if (ret > 0) monitor_latest_store(&monitor->latest, &data[ret - 1]);
+    return ret;
+}
+
+int bme680_monitor_read_batch(struct bme680_monitor *monitor, struct bme680_fifo_data *buf, int max, int min, int timeout_ms) {
+    if (!buf || max <= 0 || min < 0 || min > max || min > monitor->size) return -EINVAL;
+    if (monitor->mode != BME680_MONITOR_LOCKED) return monitor_ring_read(monitor, buf, max, min, timeout_ms);
+    return monitor_locked_read_batch(monitor, buf, max, min, timeout_ms);
+}
+
+uint64_t bme680_monitor_dropped(struct bme680_monitor *monitor) {
+    return atomic_load_explicit(&monitor->dropped, memory_order_relaxed);
+}
+
+unsigned bme680_monitor_latest(struct bme680_monitor *monitor, struct bme680_fifo_data *data) {
+    return monitor_latest_load(&monitor->latest, data);
+}
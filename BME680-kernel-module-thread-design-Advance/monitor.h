@@ -1,15 +1,52 @@
 #ifndef MONITOR_H
 #define MONITOR_H
 
+#include <stdint.h>
 #include "bme680.h"
 #include "rwlock.h"
 #include "deadlock_detector.h"
 
 struct bme680_monitor;
 
+enum bme680_monitor_mode {
+    BME680_MONITOR_LOCKED, // Mutex + condvars, checked by the deadlock detector
+    BME680_MONITOR_SPSC,   // Lock-free ring, exactly one writer and one reader thread
+    BME680_MONITOR_MPMC    // Lock-free ring, any number of writers and readers
+};
+
+/* What a write does when the monitor is full */
+enum bme680_monitor_overflow {
+    BME680_MONITOR_BLOCK,            // Wait for room (up to the timeout)
+    BME680_MONITOR_OVERWRITE_OLDEST, // Never wait: evict the oldest sample and count it as dropped
+    BME680_MONITOR_CONFLATE          // Never wait: keep only the newest sample, dropping anything pending
+};
+
+struct bme680_monitor_attr {
+    enum bme680_monitor_mode mode;
+    enum bme680_monitor_overflow overflow;
+};
+
 int bme680_monitor_init(struct bme680_monitor **monitor, int size);
+/* Ring modes round size up to a power of two */
+int bme680_monitor_init_attr(struct bme680_monitor **monitor, int size, const struct bme680_monitor_attr *attr);
 void bme680_monitor_destroy(struct bme680_monitor *monitor);
 int bme680_monitor_write(struct bme680_monitor *monitor, struct bme680_fifo_data *data);
 int bme680_monitor_read(struct bme680_monitor *monitor, struct bme680_fifo_data *data);
+/*
+ * Batches move many samples per synchronization. timeout_ms < 0 waits forever, 0 never blocks.
+ * write_batch validates all n samples first, then returns the number written (n unless it timed out).
+ * read_batch returns as soon as at least min samples (up to max) are read, or with what it has
+ * when the timeout fires (min = 0 polls). Both return -ETIMEDOUT if the timeout fired before anything moved.
+ */
+int bme680_monitor_write_batch(struct bme680_monitor *monitor, struct bme680_fifo_data *data, int n, int timeout_ms);
+int bme680_monitor_read_batch(struct bme680_monitor *monitor, struct bme680_fifo_data *buf, int max, int min, int timeout_ms);
+/* Samples discarded by the OVERWRITE_OLDEST/CONFLATE policies */
+uint64_t bme680_monitor_dropped(struct bme680_monitor *monitor);
+/*
+ * Copies the most recently written sample without consuming it, for pollers such as
+ * dashboards. Never blocks or takes a lock. Returns how many writes it reflects (0: none
+ * yet, data is zeroed); compare with the previous result to skip an unchanged sample.
+ */
+unsigned bme680_monitor_latest(struct bme680_monitor *monitor, struct bme680_fifo_data *data);
 
-#endif /* MONITOR_H */
\ No newline at end of file
+#endif /* MONITOR_H */
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "bme680.h"
+#include "monitor.h"
+#include "logger.h"
+
+/* Producer/consumer throughput of bme680_monitor in each mode: ./monitor_bench [-n samples] [-q size] */
+
+struct bench_arg {
+    struct bme680_monitor *monitor;
+    long count;
+    int failures;
+};
+
+static void *bench_producer(void *arg) {
+    struct bench_arg *b = (struct bench_arg *)arg;
+    struct bme680_fifo_data data = { .temp = 25.0, .pressure = 101325, .humidity = 50, .gas_resistance = 100000 };
+    for (long i = 0; i < b->count; i++) {
+        data.timestamp = i;
+        if (bme680_monitor_write(b->monitor, &data) != 0) b->failures++;
+    }
+    return NULL;
+}
+
+static void *bench_consumer(void *arg) {
+    struct bench_arg *b = (struct bench_arg *)arg;
+    struct bme680_fifo_data data;
+    for (long i = 0; i < b->count; i++) {
+        if (bme680_monitor_read(b->monitor, &data) != 0) b->failures++;
+    }
+    return NULL;
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_run(const char *name, enum bme680_monitor_mode mode, int threads, long samples, int size) {
+    struct bme680_monitor_attr attr = { .mode = mode };
+    struct bme680_monitor *monitor;
+    pthread_t producers[threads], consumers[threads];
+    struct bench_arg args[threads];
+    int failures = 0;
+
+    if (bme680_monitor_init_attr(&monitor, size, &attr) != 0) {
+        fprintf(stderr, "%s: init failed\n", name);
+        return;
+    }
+    double start = bench_now();
+    for (int i = 0; i < threads; i++) {
+        args[i] = (struct bench_arg){ .monitor = monitor, .count = samples / threads };
+        pthread_create(&consumers[i], NULL, bench_consumer, &args[i]);
+        pthread_create(&producers[i], NULL, bench_producer, &args[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(producers[i], NULL);
+        pthread_join(consumers[i], NULL);
+        failures += args[i].failures;
+    }
+    double elapsed = bench_now() - start;
+    long moved = samples / threads * threads;
+    printf("%-8s %dP/%dC %10ld samples %8.1f ns/sample %8.2f M samples/s%s\n", name, threads, threads, moved,
+           elapsed * 1e9 / moved, moved / elapsed / 1e6, failures ? " (failures)" : "");
+    bme680_monitor_destroy(monitor);
+}
+
+int main(int argc, char *argv[]) {
+    long samples = 1000000;
+    int size = 1024;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            samples = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        }
+    }
+
+    logger_init("monitor_bench.log");
+    logger_set_level(LOG_WARNING);
+    bench_run("locked", BME680_MONITOR_LOCKED, 1, samples, size);
+    bench_run("spsc", BME680_MONITOR_SPSC, 1, samples, size);
+    bench_run("mpmc", BME680_MONITOR_MPMC, 1, samples, size);
+    bench_run("locked", BME680_MONITOR_LOCKED, 4, samples, size);
+    bench_run("mpmc", BME680_MONITOR_MPMC, 4, samples, size);
+    logger_destroy();
+    return 0;
+}
@@ -1,105 +1,759 @@
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <sched.h>
 #include "pubsub.h"
 #include "logger.h"
-#include "event_pair.h"
+#include "sync_util.h"
+
+#define PUBSUB_HASH_BUCKETS 256 // Power of two
+#define PUBSUB_DEFAULT_QUEUE_SIZE 64
+#define PUBSUB_DEFAULT_BLOCK_MS 100
+#define PUBSUB_NUM_CLASSES 4
+#define PUBSUB_POOL_CACHE 256 // Free buffers kept per size class
+
+static const size_t pubsub_class_size[PUBSUB_NUM_CLASSES] = { 64, 256, 1024, 4096 };
+
+/*
+ * Topics are interned once into a hash table and never removed until pubsub_destroy(),
+ * so publishers can walk bucket chains and index topics by id without locking.
+ * Each topic points at an immutable snapshot of its subscribers. Writers (subscribe)
+ * serialize on ps.mutex, publish a new snapshot and free the old one after a grace
+ * period: readers announce themselves on one of two counters picked by ps.epoch, and
+ * the writer flips the epoch and waits for the old counter to drain. A reader rechecks
+ * the epoch after counting itself and moves to the other counter if it flipped, so a
+ * writer that missed its count can never have retired a snapshot the reader goes on to load.
+ *
+ * Subscriptions are MQTT-style filters stored in a trie of '/'-separated levels. A
+ * topic's snapshot is its cached match result: computed from the trie when the topic
+ * is interned and patched by every later subscribe, so publish never walks the trie.
+ *
+ * Payloads travel as refcounted messages: a header in front of the data, allocated
+ * from per-size-class free lists. A message is written once, every async queue holds
+ * a reference instead of a copy, and the last unref returns it to its class.
+ * Async subscribers own a bounded queue drained by a dispatcher thread, so publish
+ * only pays for a short critical section per subscriber.
+ */
+
+struct msg_hdr {
+    _Alignas(max_align_t) atomic_int refs;
+    int size_class; // -1: too big for the pool, plain malloc
+    size_t size;
+    struct msg_hdr *next_free;
+};
+
+struct msg_class {
+    pthread_mutex_t mutex;
+    struct msg_hdr *free_list;
+    int num_free;
+};
+
+struct sub_queue {
+    struct msg_hdr **msgs;
+    int capacity;
+    int head;
+    int count;
+    enum pubsub_overflow overflow;
+    int block_timeout_ms;
+    int stop;
+    atomic_ullong dropped;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t thread;
+};
 
 struct subscriber {
-    char *topic;
     void (*callback)(void *, size_t);
-    struct subscriber *next;
+    struct sub_queue *queue; // NULL: callback runs inside publish
+    struct subscriber *next; // All subscribers, for pubsub_destroy()
+    struct subscriber *trie_next; // Subscribers sharing the same filter
+    int has_filter;
+    struct pubsub_content_filter filter;
+    atomic_flag filter_lock; // Guards the state below against concurrent publishers
+    int have_last;
+    double last_value; // Last delivered channel value
+    uint64_t last_ns;  // Last delivery time
+};
+
+/* Only touched under ps.mutex */
+struct trie_node {
+    char *level; // NULL at the root
+    struct trie_node *children;
+    struct trie_node *sibling;
+    struct subscriber *subs; // Subscribers whose filter ends here
+};
+
+struct sub_snapshot {
+    int count;
+    struct subscriber *subs[];
+};
+
+struct topic {
+    char *name;
+    uint32_t hash;
+    int id;
+    _Atomic(struct sub_snapshot *) snapshot;
+    _Atomic(struct topic *) next; // Bucket chain
 };
 
 struct pubsub {
+    _Atomic(struct topic *) buckets[PUBSUB_HASH_BUCKETS];
+    _Atomic(struct topic *) topics[PUBSUB_MAX_TOPICS]; // By id
+    atomic_int num_topics;
     struct subscriber *subscribers;
-    pthread_mutex_t mutex;
-    event_pair_t *ep;
+    struct trie_node trie;
+    pthread_mutex_t mutex; // Serializes writers only
+    atomic_uint epoch;
+    atomic_long readers[2];
+    struct msg_class classes[PUBSUB_NUM_CLASSES];
 };
 
 static struct pubsub ps;
 
+/* FNV-1a */
+static uint32_t pubsub_hash(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static unsigned pubsub_read_lock(void) {
+    unsigned idx = atomic_load(&ps.epoch) & 1;
+    for (;;) {
+        atomic_fetch_add(&ps.readers[idx], 1);
+        unsigned now = atomic_load(&ps.epoch) & 1;
+        if (now == idx) return idx;
+        /* Flipped before our count landed; that writer may not have waited for us */
+        atomic_fetch_sub_explicit(&ps.readers[idx], 1, memory_order_release);
+        idx = now;
+    }
+}
+
+static void pubsub_read_unlock(unsigned idx) {
+    atomic_fetch_sub_explicit(&ps.readers[idx], 1, memory_order_release);
+}
+
+/* Caller holds ps.mutex; returns once no reader can still see a snapshot unpublished before the call */
+static void pubsub_synchronize(void) {
+    unsigned old = atomic_fetch_add(&ps.epoch, 1) & 1;
+    while (atomic_load(&ps.readers[old]) != 0) sched_yield();
+}
+
+static struct topic *pubsub_lookup(const char *name, uint32_t hash) {
+    struct topic *t = atomic_load_explicit(&ps.buckets[hash & (PUBSUB_HASH_BUCKETS - 1)], memory_order_acquire);
+    for (; t; t = atomic_load_explicit(&t->next, memory_order_acquire)) {
+        if (t->hash == hash && strcmp(t->name, name) == 0) return t;
+    }
+    return NULL;
+}
+
+/* '+' must fill a whole level; '#' must fill the last one */
+static int pubsub_filter_valid(const char *filter) {
+    for (const char *p = filter; *p; p++) {
+        if (*p != '+' && *p != '#') continue;
+        if (p != filter && p[-1] != '/') return 0;
+        if (*p == '+' && p[1] != '\0' && p[1] != '/') return 0;
+        if (*p == '#' && p[1] != '\0') return 0;
+    }
+    return 1;
+}
+
+/* Does a valid filter match a concrete topic name */
+static int pubsub_filter_matches(const char *filter, const char *topic) {
+    for (;;) {
+        if (filter[0] == '#') return 1;
+        const char *fend = strchr(filter, '/');
+        const char *tend = strchr(topic, '/');
+        size_t flen = fend ? (size_t)(fend - filter) : strlen(filter);
+        size_t tlen = tend ? (size_t)(tend - topic) : strlen(topic);
+        if (!(flen == 1 && filter[0] == '+') && (flen != tlen || memcmp(filter, topic, tlen) != 0)) return 0;
+        if (!fend && !tend) return 1;
+        if (!tend) return strcmp(fend, "/#") == 0; // "a/#" also matches "a"
+        if (!fend) return 0;
+        filter = fend + 1;
+        topic = tend + 1;
+    }
+}
+
+/* Caller holds ps.mutex */
+static struct trie_node *trie_insert(const char *filter) {
+    struct trie_node *node = &ps.trie;
+    const char *level = filter;
+    for (;;) {
+        const char *end = strchr(level, '/');
+        size_t len = end ? (size_t)(end - level) : strlen(level);
+        struct trie_node *child;
+        for (child = node->children; child; child = child->sibling) {
+            if (strlen(child->level) == len && memcmp(child->level, level, len) == 0) break;
+        }
+        if (!child) {
+            child = calloc(1, sizeof(struct trie_node));
+            if (!child) return NULL;
+            child->level = strndup(level, len);
+            if (!child->level) {
+                free(child);
+                return NULL;
+            }
+            child->sibling = node->children;
+            node->children = child;
+        }
+        node = child;
+        if (!end) return node;
+        level = end + 1;
+    }
+}
+
+static void trie_free(struct trie_node *node) {
+    while (node) {
+        struct trie_node *sibling = node->sibling;
+        trie_free(node->children);
+        free(node->level);
+        free(node);
+        node = sibling;
+    }
+}
+
+static int trie_take(const struct trie_node *node, struct sub_snapshot *snap) {
+    int n = 0;
+    for (struct subscriber *sub = node->subs; sub; sub = sub->trie_next, n++) {
+        if (snap) snap->subs[snap->count++] = sub;
+    }
+    return n;
+}
+
+/*
+ * Caller holds ps.mutex. Counts the subscribers matching the remaining levels of a
+ * topic (level is NULL once all are consumed) and appends them to snap if given.
+ */
+static int trie_match(const struct trie_node *node, const char *level, struct sub_snapshot *snap) {
+    int n = 0;
+    if (!level) {
+        n += trie_take(node, snap);
+        for (const struct trie_node *child = node->children; child; child = child->sibling) {
+            if (strcmp(child->level, "#") == 0) n += trie_take(child, snap);
+        }
+        return n;
+    }
+    const char *end = strchr(level, '/');
+    size_t len = end ? (size_t)(end - level) : strlen(level);
+    for (const struct trie_node *child = node->children; child; child = child->sibling) {
+        if (strcmp(child->level, "#") == 0) {
+            n += trie_take(child, snap);
+        } else if (strcmp(child->level, "+") == 0 ||
+                   (strlen(child->level) == len && memcmp(child->level, level, len) == 0)) {
+            n += trie_match(child, end ? end + 1 : NULL, snap);
+        }
+    }
+    return n;
+}
+
+/* Caller holds ps.mutex; name must not contain wildcards */
+static struct topic *pubsub_intern_locked(const char *name) {
+    uint32_t hash = pubsub_hash(name);
+    struct topic *t = pubsub_lookup(name, hash);
+    if (t) return t;
+    int id = atomic_load(&ps.num_topics);
+    if (id >= PUBSUB_MAX_TOPICS) {
+        LOGE("Too many topics, cannot add %s", name);
+        return NULL;
+    }
+    int count = trie_match(&ps.trie, name, NULL);
+    struct sub_snapshot *snap = NULL;
+    if (count) {
+        snap = malloc(sizeof(struct sub_snapshot) + count * sizeof(struct subscriber *));
+        if (!snap) return NULL;
+        snap->count = 0;
+        trie_match(&ps.trie, name, snap);
+    }
+    t = malloc(sizeof(struct topic));
+    if (t) t->name = strdup(name);
+    if (!t || !t->name) {
+        free(t);
+        free(snap);
+        return NULL;
+    }
+    t->hash = hash;
+    t->id = id;
+    atomic_init(&t->snapshot, snap);
+    _Atomic(struct topic *) *bucket = &ps.buckets[hash & (PUBSUB_HASH_BUCKETS - 1)];
+    atomic_init(&t->next, atomic_load_explicit(bucket, memory_order_relaxed));
+    atomic_store_explicit(bucket, t, memory_order_release);
+    atomic_store_explicit(&ps.topics[id], t, memory_order_release);
+    atomic_store(&ps.num_topics, id + 1);
+    return t;
+}
+
 void pubsub_init(void) {
+    memset(&ps, 0, sizeof(ps));
     pthread_mutex_init(&ps.mutex, NULL);
-    event_pair_init(&ps.ep);
-    ps.subscribers = NULL;
-    logger_log(LOG_INFO, "Pubsub initialized");
+    for (int c = 0; c < PUBSUB_NUM_CLASSES; c++) pthread_mutex_init(&ps.classes[c].mutex, NULL);
+    LOGI("Pubsub initialized");
+}
+
+static inline struct msg_hdr *msg_hdr_of(void *msg) {
+    return (struct msg_hdr *)msg - 1;
 }
 
+void *pubsub_msg_alloc(size_t size) {
+    int c = 0;
+    while (c < PUBSUB_NUM_CLASSES && size > pubsub_class_size[c]) c++;
+    struct msg_hdr *h = NULL;
+    if (c < PUBSUB_NUM_CLASSES) {
+        struct msg_class *mc = &ps.classes[c];
+        pthread_mutex_lock(&mc->mutex);
+        h = mc->free_list;
+        if (h) {
+            mc->free_list = h->next_free;
+            mc->num_free--;
+        }
+        pthread_mutex_unlock(&mc->mutex);
+        if (!h) h = malloc(sizeof(struct msg_hdr) + pubsub_class_size[c]);
+    } else {
+        c = -1;
+        h = malloc(sizeof(struct msg_hdr) + size);
+    }
+    if (!h) {
+        LOGE("Failed to allocate %zu byte message", size);
+        return NULL;
+    }
+    atomic_init(&h->refs, 1);
+    h->size_class = c;
+    h->size = size;
+    return h + 1;
+}
+
+void pubsub_msg_ref(void *msg) {
+    atomic_fetch_add_explicit(&msg_hdr_of(msg)->refs, 1, memory_order_relaxed);
+}
+
+static void msg_hdr_unref(struct msg_hdr *h) {
+    if (atomic_fetch_sub_explicit(&h->refs, 1, memory_order_acq_rel) != 1) return;
+    if (h->size_class >= 0) {
+        struct msg_class *mc = &ps.classes[h->size_class];
+        pthread_mutex_lock(&mc->mutex);
+        if (mc->num_free < PUBSUB_POOL_CACHE) {
+            h->next_free = mc->free_list;
+            mc->free_list = h;
+            mc->num_free++;
+            h = NULL;
+        }
+        pthread_mutex_unlock(&mc->mutex);
+    }
+    free(h);
+}
+
+void pubsub_msg_unref(void *msg) {
+    msg_hdr_unref(msg_hdr_of(msg));
+}
+
+size_t pubsub_msg_size(void *msg) {
+    return msg_hdr_of(msg)->size;
+}
+
+static void *pubsub_dispatch(void *arg) {
+    struct subscriber *sub = (struct subscriber *)arg;
+    struct sub_queue *q = sub->queue;
+    pthread_mutex_lock(&q->mutex);
+    for (;;) {
+        while (q->count == 0 && !q->stop) pthread_cond_wait(&q->not_empty, &q->mutex);
+        if (q->count == 0) break; // Stopped and drained
+        struct msg_hdr *h = q->msgs[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+        pthread_mutex_unlock(&q->mutex);
+        sub->callback(h + 1, h->size);
+        msg_hdr_unref(h);
+        pthread_mutex_lock(&q->mutex);
+    }
+    pthread_mutex_unlock(&q->mutex);
+    return NULL;
+}
+
+static struct sub_queue *sub_queue_create(const struct pubsub_subscribe_attr *attr) {
+    struct sub_queue *q = calloc(1, sizeof(struct sub_queue));
+    if (!q) return NULL;
+    q->capacity = attr->queue_size > 0 ? attr->queue_size : PUBSUB_DEFAULT_QUEUE_SIZE;
+    if (attr->overflow == PUBSUB_LATEST_ONLY) q->capacity = 1;
+    q->msgs = calloc(q->capacity, sizeof(struct msg_hdr *));
+    if (!q->msgs) {
+        free(q);
+        return NULL;
+    }
+    q->overflow = attr->overflow;
+    q->block_timeout_ms = attr->block_timeout_ms > 0 ? attr->block_timeout_ms : PUBSUB_DEFAULT_BLOCK_MS;
+    atomic_init(&q->dropped, 0);
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->not_empty, &cattr);
+    pthread_cond_init(&q->not_full, &cattr);
+    pthread_condattr_destroy(&cattr);
+    return q;
+}
+
+/* Dispatcher must not be running */
+static void sub_queue_free(struct sub_queue *q) {
+    for (int i = 0; i < q->count; i++) msg_hdr_unref(q->msgs[(q->head + i) % q->capacity]);
+    pthread_cond_destroy(&q->not_full);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_mutex_destroy(&q->mutex);
+    free(q->msgs);
+    free(q);
+}
+
+/* Never waits longer than the queue's block timeout */
+static void sub_queue_push(struct sub_queue *q, struct msg_hdr *h) {
+    pthread_mutex_lock(&q->mutex);
+    if (q->count == q->capacity) {
+        if (q->overflow == PUBSUB_BLOCK) {
+            struct timespec ts;
+            deadline_from_ms(&ts, q->block_timeout_ms);
+            while (q->count == q->capacity && !q->stop) {
+                if (pthread_cond_timedwait(&q->not_full, &q->mutex, &ts) == ETIMEDOUT) break;
+            }
+        } else if (q->overflow == PUBSUB_DROP_OLD || q->overflow == PUBSUB_LATEST_ONLY) {
+            msg_hdr_unref(q->msgs[q->head]);
+            q->head = (q->head + 1) % q->capacity;
+            q->count--;
+            atomic_fetch_add_explicit(&q->dropped, 1, memory_order_relaxed);
+        }
+    }
+    if (q->count == q->capacity || q->stop) {
+        pthread_mutex_unlock(&q->mutex);
+        atomic_fetch_add_explicit(&q->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    atomic_fetch_add_explicit(&h->refs, 1, memory_order_relaxed);
+    q->msgs[(q->head + q->count) % q->capacity] = h;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+/* No publisher or subscriber may run concurrently; async queues are drained first */
 void pubsub_destroy(void) {
+    for (struct subscriber *sub = ps.subscribers; sub; sub = sub->next) {
+        if (!sub->queue) continue;
+        pthread_mutex_lock(&sub->queue->mutex);
+        sub->queue->stop = 1;
+        pthread_cond_broadcast(&sub->queue->not_empty);
+        pthread_cond_broadcast(&sub->queue->not_full);
+        pthread_mutex_unlock(&sub->queue->mutex);
+        pthread_join(sub->queue->thread, NULL);
+    }
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     ts.tv_sec += 5;
     if (pthread_mutex_timedlock(&ps.mutex, &ts) != 0) {
-        logger_log(LOG_ERROR, "Timed out destroying pubsub");
+        LOGE("Timed out destroying pubsub");
         return;
     }
+    int num_topics = atomic_load(&ps.num_topics);
+    for (int i = 0; i < num_topics; i++) {
+        struct topic *t = atomic_load(&ps.topics[i]);
+        free(atomic_load(&t->snapshot));
+        free(t->name);
+        free(t);
+    }
+    trie_free(ps.trie.children);
     struct subscriber *sub = ps.subscribers;
     while (sub) {
         struct subscriber *next = sub->next;
-        free(sub->topic);
+        if (sub->queue) sub_queue_free(sub->queue);
         free(sub);
         sub = next;
     }
     pthread_mutex_unlock(&ps.mutex);
     pthread_mutex_destroy(&ps.mutex);
-    event_pair_destroy(&ps.ep);
-    logger_log(LOG_INFO, "Pubsub destroyed");
+    for (int c = 0; c < PUBSUB_NUM_CLASSES; c++) {
+        struct msg_hdr *h = ps.classes[c].free_list;
+        while (h) {
+            struct msg_hdr *next = h->next_free;
+            free(h);
+            h = next;
+        }
+        pthread_mutex_destroy(&ps.classes[c].mutex);
+    }
+    LOGI("Pubsub destroyed");
+}
+
+int pubsub_topic_id(const char *topic) {
+    if (!topic || strpbrk(topic, "+#")) return -EINVAL;
+    struct topic *t = pubsub_lookup(topic, pubsub_hash(topic));
+    if (t) return t->id;
+    pthread_mutex_lock(&ps.mutex);
+    t = pubsub_intern_locked(topic);
+    pthread_mutex_unlock(&ps.mutex);
+    return t ? t->id : -ENOSPC;
+}
+
+/*
+ * Caller holds ps.mutex. Adds sub to the trie and to the snapshot of every interned
+ * topic it matches; returns the topic id for a plain topic, 0 for a wildcard filter.
+ */
+static int pubsub_add_subscriber_locked(const char *filter, struct subscriber *sub) {
+    int id = 0;
+    if (!strpbrk(filter, "+#")) {
+        struct topic *t = pubsub_intern_locked(filter);
+        if (!t) return -ENOSPC;
+        id = t->id;
+    }
+    int num_topics = atomic_load(&ps.num_topics);
+    struct sub_snapshot **snaps = calloc(num_topics, sizeof(struct sub_snapshot *));
+    if (!snaps && num_topics) return -ENOMEM;
+    /* Build every new snapshot first so a failure leaves nothing half-updated */
+    int ret = 0;
+    for (int i = 0; i < num_topics && ret == 0; i++) {
+        struct topic *t = atomic_load(&ps.topics[i]);
+        if (!pubsub_filter_matches(filter, t->name)) continue;
+        struct sub_snapshot *old = atomic_load(&t->snapshot);
+        int count = old ? old->count : 0;
+        snaps[i] = malloc(sizeof(struct sub_snapshot) + (count + 1) * sizeof(struct subscriber *));
+        if (!snaps[i]) {
+            ret = -ENOMEM;
+            break;
+        }
+        if (count) memcpy(snaps[i]->subs, old->subs, count * sizeof(struct subscriber *));
+        snaps[i]->subs[count] = sub;
+        snaps[i]->count = count + 1;
+    }
+    struct trie_node *node = ret == 0 ? trie_insert(filter) : NULL;
+    if (!node) {
+        for (int i = 0; i < num_topics; i++) free(snaps[i]);
+        free(snaps);
+        return -ENOMEM;
+    }
+    sub->trie_next = node->subs;
+    node->subs = sub;
+    sub->next = ps.subscribers;
+    ps.subscribers = sub;
+    int retired = 0;
+    for (int i = 0; i < num_topics; i++) {
+        if (!snaps[i]) continue;
+        snaps[i] = atomic_exchange(&atomic_load(&ps.topics[i])->snapshot, snaps[i]); // Now the old one
+        if (snaps[i]) retired = 1;
+    }
+    if (retired) pubsub_synchronize();
+    for (int i = 0; i < num_topics; i++) free(snaps[i]);
+    free(snaps);
+    return id;
 }
 
 int pubsub_subscribe(const char *topic, void (*callback)(void *, size_t)) {
-    if (!topic || !callback) {
-        logger_log(LOG_ERROR, "Invalid topic or callback");
+    return pubsub_subscribe_attr(topic, callback, NULL);
+}
+
+static int content_filter_valid(const struct pubsub_content_filter *f) {
+    if (f->type < PUBSUB_FIELD_NONE || f->type > PUBSUB_FIELD_DOUBLE) return 0;
+    if (f->cmp < PUBSUB_CMP_ANY || f->cmp > PUBSUB_CMP_OUTSIDE) return 0;
+    if (f->type == PUBSUB_FIELD_NONE && (f->cmp != PUBSUB_CMP_ANY || f->deadband > 0)) return 0;
+    if ((f->cmp == PUBSUB_CMP_INSIDE || f->cmp == PUBSUB_CMP_OUTSIDE) && f->lo > f->hi) return 0;
+    return f->min_interval_ms >= 0 && f->deadband >= 0;
+}
+
+/* Reads the channel as a double; 0 if the payload is too short to hold it */
+static int content_filter_read(const struct pubsub_content_filter *f, const void *data, size_t size, double *value) {
+    static const size_t width[] = {
+        [PUBSUB_FIELD_I32] = sizeof(int32_t), [PUBSUB_FIELD_U32] = sizeof(uint32_t),
+        [PUBSUB_FIELD_I64] = sizeof(int64_t), [PUBSUB_FIELD_FLOAT] = sizeof(float),
+        [PUBSUB_FIELD_DOUBLE] = sizeof(double),
+    };
+    if (f->offset > size || size - f->offset < width[f->type]) return 0;
+    const char *p = (const char *)data + f->offset;
+    union { int32_t i32; uint32_t u32; int64_t i64; float f; double d; } v;
+    memcpy(&v, p, width[f->type]); // Payload fields need not be aligned
+    switch (f->type) {
+    case PUBSUB_FIELD_I32: *value = v.i32; break;
+    case PUBSUB_FIELD_U32: *value = v.u32; break;
+    case PUBSUB_FIELD_I64: *value = (double)v.i64; break;
+    case PUBSUB_FIELD_FLOAT: *value = v.f; break;
+    default: *value = v.d; break;
+    }
+    return 1;
+}
+
+/* Runs on the publisher's thread before anything is queued or called */
+static int content_filter_pass(struct subscriber *sub, const void *data, size_t size) {
+    const struct pubsub_content_filter *f = &sub->filter;
+    double value = 0;
+    if (f->type != PUBSUB_FIELD_NONE) {
+        if (!content_filter_read(f, data, size, &value)) return 0;
+        switch (f->cmp) {
+        case PUBSUB_CMP_LT: if (!(value < f->lo)) return 0; break;
+        case PUBSUB_CMP_GT: if (!(value > f->lo)) return 0; break;
+        case PUBSUB_CMP_INSIDE: if (value < f->lo || value > f->hi) return 0; break;
+        case PUBSUB_CMP_OUTSIDE: if (value >= f->lo && value <= f->hi) return 0; break;
+        default: break;
+        }
+    }
+    if (f->deadband <= 0 && f->min_interval_ms <= 0) return 1;
+    uint64_t now = 0;
+    if (f->min_interval_ms > 0) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        now = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+    while (atomic_flag_test_and_set_explicit(&sub->filter_lock, memory_order_acquire)) cpu_relax();
+    int pass = 1;
+    if (sub->have_last) {
+        if (f->min_interval_ms > 0 && now - sub->last_ns < (uint64_t)f->min_interval_ms * 1000000) pass = 0;
+        double moved = value > sub->last_value ? value - sub->last_value : sub->last_value - value;
+        if (f->deadband > 0 && moved < f->deadband) pass = 0;
+    }
+    if (pass) {
+        sub->have_last = 1;
+        sub->last_value = value;
+        sub->last_ns = now;
+    }
+    atomic_flag_clear_explicit(&sub->filter_lock, memory_order_release);
+    return pass;
+}
+
+int pubsub_subscribe_attr(const char *topic, void (*callback)(void *, size_t),
+                          const struct pubsub_subscribe_attr *attr) {
+    if (!topic || !callback || !pubsub_filter_valid(topic) || (attr && !content_filter_valid(&attr->filter))) {
+        LOGE("Invalid topic, callback or filter");
         return -EINVAL;
     }
-    struct subscriber *sub = malloc(sizeof(struct subscriber));
+    struct subscriber *sub = calloc(1, sizeof(struct subscriber));
     if (!sub) {
-        logger_log(LOG_ERROR, "Failed to allocate subscriber");
-        return -ENOMEM;
-    }
-    sub->topic = strdup(topic);
-    if (!sub->topic) {
-        logger_log(LOG_ERROR, "Failed to allocate topic");
-        free(sub);
+        LOGE("Failed to allocate subscriber");
         return -ENOMEM;
     }
     sub->callback = callback;
-    sub->next = NULL;
+    sub->queue = NULL;
+    atomic_flag_clear(&sub->filter_lock);
+    if (attr) {
+        sub->filter = attr->filter;
+        sub->has_filter = attr->filter.type != PUBSUB_FIELD_NONE || attr->filter.min_interval_ms > 0;
+    }
+    if (attr && attr->async) {
+        sub->queue = sub_queue_create(attr);
+        if (!sub->queue) {
+            LOGE("Failed to allocate subscriber queue");
+            free(sub);
+            return -ENOMEM;
+        }
+        if (pthread_create(&sub->queue->thread, NULL, pubsub_dispatch, sub) != 0) {
+            LOGE("Failed to create dispatcher for topic %s", topic);
+            sub_queue_free(sub->queue);
+            free(sub);
+            return -EAGAIN;
+        }
+    }
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     ts.tv_sec += 5;
-    if (pthread_mutex_timedlock(&ps.mutex, &ts) != 0) return -ETIMEDOUT;
-    sub->next = ps.subscribers;
-    ps.subscribers = sub;
-    pthread_mutex_unlock(&ps.mutex);
-    logger_log(LOG_INFO, "Subscribed to topic %s", topic);
-    return 0;
+    int ret = -ETIMEDOUT;
+    if (pthread_mutex_timedlock(&ps.mutex, &ts) == 0) {
+        ret = pubsub_add_subscriber_locked(topic, sub);
+        pthread_mutex_unlock(&ps.mutex);
+    }
+    if (ret < 0) {
+        LOGE("Failed to subscribe to topic %s: %d", topic, ret);
+        if (sub->queue) {
+            pthread_mutex_lock(&sub->queue->mutex);
+            sub->queue->stop = 1;
+            pthread_cond_signal(&sub->queue->not_empty);
+            pthread_mutex_unlock(&sub->queue->mutex);
+            pthread_join(sub->queue->thread, NULL);
+            sub_queue_free(sub->queue);
+        }
+        free(sub);
+        return ret;
+    }
+    LOGI("Subscribed to topic %s (id %d%s)", topic, ret, sub->queue ? ", async" : "");
+    return ret;
+}
+
+/*
+ * h may be NULL, in which case data is copied into a pooled message only once some
+ * subscriber's filter accepts it; a sample nobody wants is never copied.
+ */
+static int pubsub_deliver(struct topic *t, const void *data, size_t size, struct msg_hdr *h) {
+    struct msg_hdr *owned = NULL;
+    int ret = 0;
+    unsigned idx = pubsub_read_lock();
+    struct sub_snapshot *snap = atomic_load(&t->snapshot);
+    for (int i = 0; snap && i < snap->count; i++) {
+        struct subscriber *sub = snap->subs[i];
+        if (sub->has_filter && !content_filter_pass(sub, data, size)) continue;
+        if (!h) {
+            void *msg = pubsub_msg_alloc(size);
+            if (!msg) {
+                ret = -ENOMEM;
+                break;
+            }
+            memcpy(msg, data, size);
+            h = owned = msg_hdr_of(msg);
+        }
+        if (sub->queue) {
+            sub_queue_push(sub->queue, h);
+        } else {
+            sub->callback(h + 1, h->size);
+        }
+    }
+    pubsub_read_unlock(idx);
+    if (owned) msg_hdr_unref(owned);
+    return ret;
 }
 
 void pubsub_publish(const char *topic, void *data, size_t size) {
     if (!topic || !data) {
-        logger_log(LOG_ERROR, "Invalid topic or data");
+        LOGE("Invalid topic or data");
         return;
     }
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    ts.tv_sec += 5;
-    if (pthread_mutex_timedlock(&ps.mutex, &ts) != 0) return;
-    struct subscriber *sub = ps.subscribers;
-    while (sub) {
-        if (strcmp(sub->topic, topic) == 0) {
-            if (sub->callback) {
-                sub->callback(data, size);
-                event_pair_signal1(&ps.ep);
-                event_pair_wait2(&ps.ep); // Two-way synchronization
-            } else {
-                logger_log(LOG_ERROR, "Invalid callback for topic %s", topic);
-            }
+    struct topic *t = pubsub_lookup(topic, pubsub_hash(topic));
+    if (!t) {
+        /* First publish: match it against the trie once and cache the result */
+        int id = pubsub_topic_id(topic);
+        if (id < 0) {
+            LOGE("Cannot publish to topic %s: %d", topic, id);
+            return;
         }
-        sub = sub->next;
+        t = atomic_load_explicit(&ps.topics[id], memory_order_acquire);
+    }
+    pubsub_deliver(t, data, size, NULL);
+    LOGD("Published to topic %s", topic);
+}
+
+int pubsub_publish_id(int topic_id, void *data, size_t size) {
+    if (topic_id < 0 || topic_id >= atomic_load(&ps.num_topics) || !data) {
+        LOGE("Invalid topic id %d or data", topic_id);
+        return -EINVAL;
+    }
+    return pubsub_deliver(atomic_load_explicit(&ps.topics[topic_id], memory_order_acquire), data, size, NULL);
+}
+
+int pubsub_publish_msg(int topic_id, void *msg) {
+    if (!msg) return -EINVAL;
+    if (topic_id < 0 || topic_id >= atomic_load(&ps.num_topics)) {
+        LOGE("Invalid topic id %d", topic_id);
+        pubsub_msg_unref(msg);
+        return -EINVAL;
+    }
+    struct msg_hdr *h = msg_hdr_of(msg);
+    pubsub_deliver(atomic_load_explicit(&ps.topics[topic_id], memory_order_acquire), msg, h->size, h);
+    pubsub_msg_unref(msg);
+    return 0;
+}
+
+uint64_t pubsub_dropped(void) {
+    uint64_t total = 0;
+    pthread_mutex_lock(&ps.mutex);
+    for (struct subscriber *sub = ps.subscribers; sub; sub = sub->next) {
+        if (sub->queue) total += atomic_load_explicit(&sub->queue->dropped, memory_order_relaxed);
     }
     pthread_mutex_unlock(&ps.mutex);
-    logger_log(LOG_DEBUG, "Published to topic %s", topic);
-}
\ No newline at end of file
+    return total;
+}
@@ -1,9 +1,97 @@
 #ifndef PUBSUB_H
 #define PUBSUB_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#define PUBSUB_MAX_TOPICS 1024
+
+/* What publish does when an async subscriber's queue is full */
+enum pubsub_overflow {
+    PUBSUB_BLOCK,       // Wait up to block_timeout_ms for room, then drop the new message
+    PUBSUB_DROP_NEW,    // Drop the new message
+    PUBSUB_DROP_OLD,    // Drop the oldest queued message
+    PUBSUB_LATEST_ONLY  // Keep only the newest message (queue_size is ignored)
+};
+
+/* Type of the payload field a content filter looks at */
+enum pubsub_field_type {
+    PUBSUB_FIELD_NONE,  // No channel: only min_interval_ms applies
+    PUBSUB_FIELD_I32,
+    PUBSUB_FIELD_U32,
+    PUBSUB_FIELD_I64,
+    PUBSUB_FIELD_FLOAT,
+    PUBSUB_FIELD_DOUBLE
+};
+
+enum pubsub_cmp {
+    PUBSUB_CMP_ANY,     // Any value
+    PUBSUB_CMP_LT,      // value < lo
+    PUBSUB_CMP_GT,      // value > lo
+    PUBSUB_CMP_INSIDE,  // lo <= value <= hi
+    PUBSUB_CMP_OUTSIDE  // value < lo or value > hi
+};
+
+/*
+ * Evaluated by the publisher before a message is copied, queued or dispatched, so a
+ * sample that fails it costs the subscriber nothing. All zero means no filter.
+ */
+struct pubsub_content_filter {
+    enum pubsub_field_type type;
+    size_t offset;        // Channel: offsetof() the field in the payload
+    enum pubsub_cmp cmp;
+    double lo, hi;
+    double deadband;      // > 0: skip until the channel moves this far from the last delivered value
+    int min_interval_ms;  // > 0: at most one delivery per interval
+};
+
+/* e.g. { PUBSUB_CHANNEL(PUBSUB_FIELD_U32, struct bme680_fifo_data, humidity), .cmp = PUBSUB_CMP_GT, .lo = 80000 } */
+#define PUBSUB_CHANNEL(ftype, stype, member) .type = (ftype), .offset = offsetof(stype, member)
+
+struct pubsub_subscribe_attr {
+    int async;            // 0: callback runs on the publisher's thread and must be quick
+    int queue_size;       // Async only; 0 selects the default (64)
+    enum pubsub_overflow overflow;
+    int block_timeout_ms; // PUBSUB_BLOCK only; 0 selects the default (100 ms)
+    struct pubsub_content_filter filter;
+};
+
 void pubsub_init(void);
 void pubsub_destroy(void);
+/*
+ * topic may be an MQTT-style filter over '/'-separated levels: '+' matches exactly one
+ * level and a trailing '#' any number of remaining levels, e.g. "sensors/+/temp".
+ * Returns the topic id for a plain topic and 0 for a filter with wildcards; must not
+ * be called from inside a callback.
+ */
 int pubsub_subscribe(const char *topic, void (*callback)(void *, size_t));
+/*
+ * Async subscribers receive each message on their own dispatcher thread, so publish
+ * never waits on the callback. attr may be NULL (synchronous).
+ */
+int pubsub_subscribe_attr(const char *topic, void (*callback)(void *, size_t),
+                          const struct pubsub_subscribe_attr *attr);
+/* Interns a plain topic and returns its id, for use with pubsub_publish_id() */
+int pubsub_topic_id(const char *topic);
+/*
+ * Lock-free once the topic is known: one hash lookup, then the topic's cached list of
+ * matching subscribers. The first publish to a topic interns it. data is copied once.
+ */
 void pubsub_publish(const char *topic, void *data, size_t size);
+int pubsub_publish_id(int topic_id, void *data, size_t size);
+/*
+ * Refcounted messages from a size-class pool. The data pointer handed to callbacks is
+ * always such a message and is valid until the callback returns; call pubsub_msg_ref()
+ * to keep it longer. Messages are shared between subscribers and must not be modified
+ * once published. Every reference must be dropped before pubsub_destroy().
+ */
+void *pubsub_msg_alloc(size_t size); // Reference count 1
+void pubsub_msg_ref(void *msg);
+void pubsub_msg_unref(void *msg);
+size_t pubsub_msg_size(void *msg);
+/* Publishes without copying; consumes the caller's reference */
+int pubsub_publish_msg(int topic_id, void *msg);
+/* Messages async subscribers lost to overflow, summed over all subscribers */
+uint64_t pubsub_dropped(void);
 
-#endif /* PUBSUB_H */
\ No newline at end of file
+#endif /* PUBSUB_H */
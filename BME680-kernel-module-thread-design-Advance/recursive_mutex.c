@@ -1,67 +1,90 @@
-#include <pthread.h>
 #include <stdlib.h>
 #include <errno.h>
 #include "recursive_mutex.h"
 #include "logger.h"
+#include "sync_util.h"
 
-struct recursive_mutex {
-    pthread_mutex_t mutex;
-    pthread_t owner;
-    int count;
-};
+/*
+ * Owner ids are handed out per thread from a counter rather than read with gettid(): no
+ * syscall, and a forked child's thread keeps the id it locked with, so it can still
+ * unlock a mutex it held across fork().
+ */
+static atomic_int next_tid = 1;
+static __thread int tls_tid;
+
+static inline int recursive_mutex_tid(void) {
+    if (!tls_tid) tls_tid = atomic_fetch_add_explicit(&next_tid, 1, memory_order_relaxed);
+    return tls_tid;
+}
 
 int recursive_mutex_init(recursive_mutex_t *rmutex) {
-    rmutex = malloc(sizeof(struct recursive_mutex));
-    if (!rmutex) {
-        logger_log(LOG_ERROR, "Failed to allocate recursive mutex");
-        return -ENOMEM;
-    }
-    pthread_mutexattr_t attr;
-    pthread_mutexattr_init(&attr);
-    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-    pthread_mutex_init(&rmutex->mutex, &attr);
-    pthread_mutexattr_destroy(&attr);
-    rmutex->owner = 0;
+    atomic_init(&rmutex->state, 0);
+    atomic_init(&rmutex->owner, 0);
     rmutex->count = 0;
-    logger_log(LOG_INFO, "Recursive mutex initialized");
+    LOGI("Recursive mutex initialized");
     return 0;
 }
 
 void recursive_mutex_destroy(recursive_mutex_t *rmutex) {
-    pthread_mutex_destroy(&rmutex->mutex);
-    free(rmutex);
-    logger_log(LOG_INFO, "Recursive mutex destroyed");
+    if (atomic_load(&rmutex->state) != 0) LOGW("Recursive mutex destroyed while held by thread %d",
+                                               atomic_load(&rmutex->owner));
+    LOGI("Recursive mutex destroyed");
+}
+
+/*
+ * Only the owner ever stores its own TID in owner, so a relaxed load that returns our TID
+ * proves we hold the lock, and any other value proves we do not.
+ */
+static inline int recursive_mutex_reenter(recursive_mutex_t *rmutex, int tid) {
+    if (atomic_load_explicit(&rmutex->owner, memory_order_relaxed) != tid) return 0;
+    rmutex->count++;
+    LOGD("Recursive mutex lock incremented: count=%d", rmutex->count);
+    return 1;
+}
+
+static inline void recursive_mutex_take(recursive_mutex_t *rmutex, int tid) {
+    atomic_store_explicit(&rmutex->owner, tid, memory_order_relaxed);
+    rmutex->count = 1;
+    LOGD("Recursive mutex locked by thread %d", tid);
 }
 
 int recursive_mutex_lock(recursive_mutex_t *rmutex) {
-    pthread_t current = pthread_self();
-    if (rmutex->owner == current) {
-        rmutex->count++;
-        logger_log(LOG_DEBUG, "Recursive mutex lock incremented: count=%d", rmutex->count);
-        return 0;
+    int tid = recursive_mutex_tid();
+    if (recursive_mutex_reenter(rmutex, tid)) return 0;
+    int c = 0;
+    if (!atomic_compare_exchange_strong_explicit(&rmutex->state, &c, 1, memory_order_acquire, memory_order_relaxed)) {
+        /* Contended: mark sleepers so the unlocker knows to wake, then sleep until we swap in 0 */
+        if (c != 2) c = atomic_exchange_explicit(&rmutex->state, 2, memory_order_acquire);
+        while (c != 0) {
+            futex_wait(&rmutex->state, 2, NULL);
+            c = atomic_exchange_explicit(&rmutex->state, 2, memory_order_acquire);
+        }
     }
-    int ret = pthread_mutex_lock(&rmutex->mutex);
-    if (ret == 0) {
-        rmutex->owner = current;
-        rmutex->count = 1;
-        logger_log(LOG_DEBUG, "Recursive mutex locked by thread %lu", (unsigned long)current);
-    }
-    return ret;
+    recursive_mutex_take(rmutex, tid);
+    return 0;
+}
+
+int recursive_mutex_trylock(recursive_mutex_t *rmutex) {
+    int tid = recursive_mutex_tid();
+    if (recursive_mutex_reenter(rmutex, tid)) return 0;
+    int c = 0;
+    if (!atomic_compare_exchange_strong_explicit(&rmutex->state, &c, 1, memory_order_acquire, memory_order_relaxed))
+        return -EBUSY;
+    recursive_mutex_take(rmutex, tid);
+    return 0;
 }
 
 int recursive_mutex_unlock(recursive_mutex_t *rmutex) {
-    pthread_t current = pthread_self();
-    if (rmutex->owner != current) {
-        logger_log(LOG_ERROR, "Attempt to unlock recursive mutex by non-owner thread");
+    if (atomic_load_explicit(&rmutex->owner, memory_order_relaxed) != recursive_mutex_tid()) {
+        LOGE("Attempt to unlock recursive mutex by non-owner thread");
         return -EPERM;
     }
-    rmutex->count--;
-    if (rmutex->count == 0) {
-        rmutex->owner = 0;
-        pthread_mutex_unlock(&rmutex->mutex);
-        logger_log(LOG_DEBUG, "Recursive mutex fully unlocked");
-    } else {
-        logger_log(LOG_DEBUG, "Recursive mutex lock decremented: count=%d", rmutex->count);
+    if (--rmutex->count > 0) {
+        LOGD("Recursive mutex lock decremented: count=%d", rmutex->count);
+        return 0;
     }
+    atomic_store_explicit(&rmutex->owner, 0, memory_order_relaxed);
+    if (atomic_exchange_explicit(&rmutex->state, 0, memory_order_release) == 2) futex_wake(&rmutex->state, 1);
+    LOGD("Recursive mutex fully unlocked");
     return 0;
-}
\ No newline at end of file
+}
@@ -1,11 +1,26 @@
 #ifndef RECURSIVE_MUTEX_H
 #define RECURSIVE_MUTEX_H
 
-typedef struct recursive_mutex recursive_mutex_t;
+#include <stdatomic.h>
+
+/*
+ * Recursive mutex on a single futex word. The owner's thread id is kept atomically, so
+ * re-entry is one relaxed compare against the caller's cached id and a plain count
+ * bump; only the first lock and the last unlock touch the futex word. Embed it and
+ * recursive_mutex_init() it.
+ */
+typedef struct recursive_mutex {
+    atomic_int state; // 0 unlocked, 1 locked, 2 locked with sleepers
+    atomic_int owner; // Thread id of the holder, 0 when unlocked
+    int count;        // Recursion depth, only touched by the owner
+} recursive_mutex_t;
 
 int recursive_mutex_init(recursive_mutex_t *rmutex);
 void recursive_mutex_destroy(recursive_mutex_t *rmutex);
 int recursive_mutex_lock(recursive_mutex_t *rmutex);
+/* -EBUSY if another thread holds it */
+int recursive_mutex_trylock(recursive_mutex_t *rmutex);
+/* -EPERM unless the caller holds it */
 int recursive_mutex_unlock(recursive_mutex_t *rmutex);
 
-#endif /* RECURSIVE_MUTEX_H */
\ No newline at end of file
+#endif /* RECURSIVE_MUTEX_H */
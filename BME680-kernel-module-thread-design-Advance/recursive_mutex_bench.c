@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "recursive_mutex.h"
+#include "logger.h"
+
+/* Lock/unlock cost of recursive_mutex_t, the previous pthread-backed version and glibc: ./recursive_mutex_bench [-n ops] */
+
+/* Previous implementation: PTHREAD_MUTEX_RECURSIVE plus its own owner/count */
+struct legacy_mutex {
+    pthread_mutex_t mutex;
+    pthread_t owner;
+    int count;
+};
+
+static void legacy_init(struct legacy_mutex *m) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&m->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    m->owner = 0;
+    m->count = 0;
+}
+
+static void legacy_lock(struct legacy_mutex *m) {
+    pthread_t current = pthread_self();
+    if (m->owner == current) {
+        m->count++;
+        return;
+    }
+    pthread_mutex_lock(&m->mutex);
+    m->owner = current;
+    m->count = 1;
+}
+
+static void legacy_unlock(struct legacy_mutex *m) {
+    if (--m->count == 0) {
+        m->owner = 0;
+        pthread_mutex_unlock(&m->mutex);
+    }
+}
+
+enum bench_lock { BENCH_FUTEX, BENCH_LEGACY, BENCH_GLIBC };
+
+static const char *bench_names[] = { "futex", "legacy", "glibc" };
+
+struct bench_arg {
+    enum bench_lock kind;
+    long ops;
+    int depth; // Nested locks per operation
+};
+
+static recursive_mutex_t rmutex;
+static struct legacy_mutex legacy;
+static pthread_mutex_t glibc_mutex;
+static volatile long shared_value;
+
+static void *bench_thread(void *arg) {
+    struct bench_arg *b = (struct bench_arg *)arg;
+    for (long i = 0; i < b->ops; i++) {
+        for (int d = 0; d < b->depth; d++) {
+            if (b->kind == BENCH_FUTEX) recursive_mutex_lock(&rmutex);
+            else if (b->kind == BENCH_LEGACY) legacy_lock(&legacy);
+            else pthread_mutex_lock(&glibc_mutex);
+        }
+        shared_value++;
+        for (int d = 0; d < b->depth; d++) {
+            if (b->kind == BENCH_FUTEX) recursive_mutex_unlock(&rmutex);
+            else if (b->kind == BENCH_LEGACY) legacy_unlock(&legacy);
+            else pthread_mutex_unlock(&glibc_mutex);
+        }
+    }
+    return NULL;
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_run(enum bench_lock kind, int threads, long ops, int depth) {
+    pthread_t tids[threads];
+    struct bench_arg args[threads];
+
+    double start = bench_now();
+    for (int i = 0; i < threads; i++) {
+        args[i] = (struct bench_arg){ .kind = kind, .ops = ops / threads, .depth = depth };
+        pthread_create(&tids[i], NULL, bench_thread, &args[i]);
+    }
+    for (int i = 0; i < threads; i++) pthread_join(tids[i], NULL);
+    double elapsed = bench_now() - start;
+    long done = ops / threads * threads;
+    printf("%-7s %d threads depth %d %8.1f ns/op (lock+unlock x depth)\n", bench_names[kind], threads, depth,
+           elapsed * 1e9 / done);
+}
+
+int main(int argc, char *argv[]) {
+    long ops = 4000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ops = atol(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-n ops]\n", argv[0]);
+            return 1;
+        }
+    }
+    logger_init("recursive_mutex_bench.log");
+    logger_set_level(LOG_WARNING);
+    recursive_mutex_init(&rmutex);
+    legacy_init(&legacy);
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&glibc_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    const int depths[] = { 1, 4 };
+    const int thread_counts[] = { 1, 4 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+            for (int kind = BENCH_FUTEX; kind <= BENCH_GLIBC; kind++)
+                bench_run(kind, thread_counts[t], ops, depths[d]);
+        }
+    }
+
+    pthread_mutex_destroy(&glibc_mutex);
+    pthread_mutex_destroy(&legacy.mutex);
+    recursive_mutex_destroy(&rmutex);
+    logger_destroy();
+    return 0;
+}
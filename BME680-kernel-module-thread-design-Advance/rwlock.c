@@ -1,151 +1,174 @@
-#include <pthread.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <limits.h>
 #include <time.h>
 #include "rwlock.h"
 #include "logger.h"
+#include "sync_util.h"
 
 #define MAX_WAITING_READERS 10
 #define MAX_WAITING_WRITERS 5
 
-struct rwlock {
-    pthread_mutex_t mutex;
-    pthread_cond_t readers_proceed;
-    pthread_cond_t writer_proceed;
-    int active_readers;
-    int active_writers;
-    int waiting_readers;
-    int waiting_writers;
-};
+/*
+ * State word layout. A reader may enter while no writer is active or waiting, so a
+ * waiting writer holds off new readers (writer preference). A waiting writer enters once
+ * the readers drain. Each waiter snapshots its side's wake word before rechecking state;
+ * whoever changes state in its favour bumps that word afterwards, so no wake-up is lost.
+ */
+#define RW_READERS_MASK 0xffff     // Active readers
+#define RW_WWAIT_ONE (1 << 16)     // Waiting writers, 7 bits
+#define RW_WWAIT_MASK (0x7f << 16)
+#define RW_RWAIT_ONE (1 << 23)     // Waiting readers, 7 bits
+#define RW_RWAIT_MASK (0x7f << 23)
+#define RW_WRITER (1 << 30)        // A writer holds the lock
+
+#define RW_TIMEOUT_MS 5000
 
 int rwlock_init(rwlock_t *rwlock) {
-    rwlock = malloc(sizeof(struct rwlock));
-    if (!rwlock) {
-        logger_log(LOG_ERROR, "Failed to allocate rwlock");
-        return -ENOMEM;
-    }
-    pthread_mutex_init(&rwlock->mutex, NULL);
-    pthread_cond_init(&rwlock->readers_proceed, NULL);
-    pthread_cond_init(&rwlock->writer_proceed, NULL);
-    rwlock->active_readers = 0;
-    rwlock->active_writers = 0;
-    rwlock->waiting_readers = 0;
-    rwlock->waiting_writers = 0;
-    logger_log(LOG_INFO, "Read-write lock initialized");
+    atomic_init(&rwlock->state, 0);
+    atomic_init(&rwlock->reader_wake, 0);
+    atomic_init(&rwlock->writer_wake, 0);
+    LOGI("Read-write lock initialized");
     return 0;
 }
 
 void rwlock_destroy(rwlock_t *rwlock) {
-    pthread_mutex_destroy(&rwlock->mutex);
-    pthread_cond_destroy(&rwlock->readers_proceed);
-    pthread_cond_destroy(&rwlock->writer_proceed);
-    free(rwlock);
-    logger_log(LOG_INFO, "Read-write lock destroyed");
+    int state = atomic_load(&rwlock->state);
+    if (state != 0) LOGW("Read-write lock destroyed while in use: state=%#x", state);
+    LOGI("Read-write lock destroyed");
 }
 
-int rwlock_rdlock(rwlock_t *rwlock) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    ts.tv_sec += 5; // 5-second timeout
+static void rwlock_wake(atomic_int *word) {
+    atomic_fetch_add(word, 1);
+    futex_wake(word, INT_MAX);
+}
 
-    pthread_mutex_lock(&rwlock->mutex);
-    if (rwlock->waiting_readers >= MAX_WAITING_READERS) {
-        pthread_mutex_unlock(&rwlock->mutex);
-        logger_log(LOG_ERROR, "Too many waiting readers: %d", rwlock->waiting_readers);
-        return -EAGAIN;
-    }
-    rwlock->waiting_readers++;
-    while (rwlock->active_writers || rwlock->waiting_writers) {
-        int ret = pthread_cond_timedwait(&rwlock->readers_proceed, &rwlock->mutex, &ts);
-        if (ret == ETIMEDOUT) {
-            rwlock->waiting_readers--;
-            pthread_mutex_unlock(&rwlock->mutex);
-            logger_log(LOG_ERROR, "Read lock timed out");
-            return -ETIMEDOUT;
+/* Called with the state after a waiter left or a holder released it */
+static void rwlock_wake_waiters(rwlock_t *rwlock, int state) {
+    if (state & (RW_WRITER | RW_READERS_MASK)) return;
+    if (state & RW_WWAIT_MASK) rwlock_wake(&rwlock->writer_wake);
+    else if (state & RW_RWAIT_MASK) rwlock_wake(&rwlock->reader_wake);
+}
+
+static int rwlock_read_blocked(int state) {
+    return (state & (RW_WRITER | RW_WWAIT_MASK)) || (state & RW_READERS_MASK) == RW_READERS_MASK;
+}
+
+/* deadline NULL: RW_TIMEOUT_MS from the first sleep, so the uncontended path never reads the clock */
+static int rwlock_read_acquire(rwlock_t *rwlock, const struct timespec *deadline) {
+    struct timespec ts;
+    int state = atomic_load_explicit(&rwlock->state, memory_order_relaxed);
+    int waiting = 0;
+    for (;;) {
+        if (!rwlock_read_blocked(state)) {
+            int next = state + 1 - (waiting ? RW_RWAIT_ONE : 0);
+            if (atomic_compare_exchange_weak_explicit(&rwlock->state, &state, next,
+                                                      memory_order_acquire, memory_order_relaxed))
+                break;
+            continue;
         }
-        if (ret != 0) {
-            rwlock->waiting_readers--;
-            pthread_mutex_unlock(&rwlock->mutex);
-            logger_log(LOG_ERROR, "Read lock wait failed: %s", strerror(ret));
-            return ret;
+        if (!waiting) {
+            if ((state & RW_RWAIT_MASK) >> 23 >= MAX_WAITING_READERS) {
+                LOGE("Too many waiting readers: %d", (state & RW_RWAIT_MASK) >> 23);
+                return -EAGAIN;
+            }
+            if (!atomic_compare_exchange_weak(&rwlock->state, &state, state + RW_RWAIT_ONE)) continue;
+            waiting = 1;
         }
+        int word = atomic_load(&rwlock->reader_wake);
+        state = atomic_load(&rwlock->state);
+        if (!rwlock_read_blocked(state)) continue;
+        if (!deadline) {
+            deadline_from_ms(&ts, RW_TIMEOUT_MS);
+            deadline = &ts;
+        }
+        int ret = futex_wait(&rwlock->reader_wake, word, deadline);
+        if (ret == -ETIMEDOUT) {
+            atomic_fetch_sub(&rwlock->state, RW_RWAIT_ONE);
+            LOGE("Read lock timed out");
+            return -ETIMEDOUT;
+        }
+        state = atomic_load_explicit(&rwlock->state, memory_order_relaxed);
     }
-    rwlock->waiting_readers--;
-    rwlock->active_readers++;
-    if (rwlock->active_readers < 0 || rwlock->active_writers < 0) {
-        pthread_mutex_unlock(&rwlock->mutex);
-        logger_log(LOG_ERROR, "Invalid rwlock state: readers=%d, writers=%d", rwlock->active_readers, rwlock->active_writers);
-        return -EINVAL;
-    }
-    pthread_mutex_unlock(&rwlock->mutex);
-    logger_log(LOG_DEBUG, "Read lock acquired");
+    LOGD("Read lock acquired");
     return 0;
 }
 
-int rwlock_wrlock(rwlock_t *rwlock) {
+static int rwlock_write_acquire(rwlock_t *rwlock, const struct timespec *deadline) {
     struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    ts.tv_sec += 5; // 5-second timeout
-
-    pthread_mutex_lock(&rwlock->mutex);
-    if (rwlock->waiting_writers >= MAX_WAITING_WRITERS) {
-        pthread_mutex_unlock(&rwlock->mutex);
-        logger_log(LOG_ERROR, "Too many waiting writers: %d", rwlock->waiting_writers);
-        return -EAGAIN;
-    }
-    rwlock->waiting_writers++;
-    while (rwlock->active_readers || rwlock->active_writers) {
-        int ret = pthread_cond_timedwait(&rwlock->writer_proceed, &rwlock->mutex, &ts);
-        if (ret == ETIMEDOUT) {
-            rwlock->waiting_writers--;
-            pthread_mutex_unlock(&rwlock->mutex);
-            logger_log(LOG_ERROR, "Write lock timed out");
-            return -ETIMEDOUT;
+    int state = atomic_load_explicit(&rwlock->state, memory_order_relaxed);
+    int waiting = 0;
+    for (;;) {
+        if (!(state & (RW_WRITER | RW_READERS_MASK))) {
+            int next = (state | RW_WRITER) - (waiting ? RW_WWAIT_ONE : 0);
+            if (atomic_compare_exchange_weak_explicit(&rwlock->state, &state, next,
+                                                      memory_order_acquire, memory_order_relaxed))
+                break;
+            continue;
         }
-        if (ret != 0) {
-            rwlock->waiting_writers--;
-            pthread_mutex_unlock(&rwlock->mutex);
-            logger_log(LOG_ERROR, "Write lock wait failed: %s", strerror(ret));
-            return ret;
+        if (!waiting) {
+            if ((state & RW_WWAIT_MASK) >> 16 >= MAX_WAITING_WRITERS) {
+                LOGE("Too many waiting writers: %d", (state & RW_WWAIT_MASK) >> 16);
+                return -EAGAIN;
+            }
+            if (!atomic_compare_exchange_weak(&rwlock->state, &state, state + RW_WWAIT_ONE)) continue;
+            waiting = 1;
         }
+        int word = atomic_load(&rwlock->writer_wake);
+        state = atomic_load(&rwlock->state);
+        if (!(state & (RW_WRITER | RW_READERS_MASK))) continue;
+        if (!deadline) {
+            deadline_from_ms(&ts, RW_TIMEOUT_MS);
+            deadline = &ts;
+        }
+        int ret = futex_wait(&rwlock->writer_wake, word, deadline);
+        if (ret == -ETIMEDOUT) {
+            /* Readers held off by us may be able to go now, even while other readers are active */
+            state = atomic_fetch_sub(&rwlock->state, RW_WWAIT_ONE) - RW_WWAIT_ONE;
+            if (!(state & (RW_WRITER | RW_WWAIT_MASK)) && (state & RW_RWAIT_MASK))
+                rwlock_wake(&rwlock->reader_wake);
+            else
+                rwlock_wake_waiters(rwlock, state);
+            LOGE("Write lock timed out");
+            return -ETIMEDOUT;
+        }
+        state = atomic_load_explicit(&rwlock->state, memory_order_relaxed);
     }
-    rwlock->waiting_writers--;
-    rwlock->active_writers++;
-    if (rwlock->active_readers < 0 || rwlock->active_writers < 0) {
-        pthread_mutex_unlock(&rwlock->mutex);
-        logger_log(LOG_ERROR, "Invalid rwlock state: readers=%d, writers=%d", rwlock->active_readers, rwlock->active_writers);
-        return -EINVAL;
-    }
-    pthread_mutex_unlock(&rwlock->mutex);
-    logger_log(LOG_DEBUG, "Write lock acquired");
+    LOGD("Write lock acquired");
     return 0;
 }
 
+int rwlock_rdlock(rwlock_t *rwlock) {
+    return rwlock_read_acquire(rwlock, NULL);
+}
+
+int rwlock_wrlock(rwlock_t *rwlock) {
+    return rwlock_write_acquire(rwlock, NULL);
+}
+
+int rwlock_timedrdlock(rwlock_t *rwlock, const struct timespec *deadline) {
+    return rwlock_read_acquire(rwlock, deadline);
+}
+
+int rwlock_timedwrlock(rwlock_t *rwlock, const struct timespec *deadline) {
+    return rwlock_write_acquire(rwlock, deadline);
+}
+
 int rwlock_unlock(rwlock_t *rwlock) {
-    pthread_mutex_lock(&rwlock->mutex);
-    if (rwlock->active_writers) {
-        rwlock->active_writers--;
-        if (rwlock->waiting_writers) {
-            pthread_cond_signal(&rwlock->writer_proceed);
-        } else {
-            pthread_cond_broadcast(&rwlock->readers_proceed);
-        }
-    } else if (rwlock->active_readers) {
-        rwlock->active_readers--;
-        if (rwlock->active_readers == 0 && rwlock->waiting_writers) {
-            pthread_cond_signal(&rwlock->writer_proceed);
-        }
+    int state = atomic_load_explicit(&rwlock->state, memory_order_relaxed);
+    if (state & RW_WRITER) {
+        state = atomic_fetch_sub_explicit(&rwlock->state, RW_WRITER, memory_order_release) - RW_WRITER;
     } else {
-        pthread_mutex_unlock(&rwlock->mutex);
-        logger_log(LOG_ERROR, "Attempt to unlock rwlock with no active readers or writers");
-        return -EPERM;
+        do {
+            if (!(state & RW_READERS_MASK)) {
+                LOGE("Attempt to unlock rwlock with no active readers or writers");
+                return -EPERM;
+            }
+        } while (!atomic_compare_exchange_weak_explicit(&rwlock->state, &state, state - 1,
+                                                        memory_order_release, memory_order_relaxed));
+        state--;
     }
-    if (rwlock->active_readers < 0 || rwlock->active_writers < 0) {
-        pthread_mutex_unlock(&rwlock->mutex);
-        logger_log(LOG_ERROR, "Invalid rwlock state: readers=%d, writers=%d", rwlock->active_readers, rwlock->active_writers);
-        return -EINVAL;
-    }
-    pthread_mutex_unlock(&rwlock->mutex);
-    logger_log(LOG_DEBUG, "Lock released");
+    rwlock_wake_waiters(rwlock, state);
+    LOGD("Lock released");
     return 0;
-}
\ No newline at end of file
+}
@@ -1,12 +1,28 @@
 #ifndef RWLOCK_H
 #define RWLOCK_H
 
-typedef struct rwlock rwlock_t;
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+ * Writer-preferring read-write lock built on one atomic state word. Readers and
+ * writers that find it free take it with a single CAS and never enter the kernel;
+ * only contended waiters sleep, on a futex per side. Embed it and rwlock_init() it.
+ */
+typedef struct rwlock {
+    atomic_int state;        // Active readers, waiting writers/readers, writer bit
+    atomic_int reader_wake;  // Futex words bumped to wake the sleeping side
+    atomic_int writer_wake;
+} rwlock_t;
 
 int rwlock_init(rwlock_t *rwlock);
 void rwlock_destroy(rwlock_t *rwlock);
+/* 5 s timeout; -EAGAIN if too many are already waiting */
 int rwlock_rdlock(rwlock_t *rwlock);
 int rwlock_wrlock(rwlock_t *rwlock);
+/* deadline is an absolute CLOCK_MONOTONIC time */
+int rwlock_timedrdlock(rwlock_t *rwlock, const struct timespec *deadline);
+int rwlock_timedwrlock(rwlock_t *rwlock, const struct timespec *deadline);
 int rwlock_unlock(rwlock_t *rwlock);
 
-#endif /* RWLOCK_H */
\ No newline at end of file
+#endif /* RWLOCK_H */
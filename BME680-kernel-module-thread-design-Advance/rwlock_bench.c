@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "rwlock.h"
+#include "brlock.h"
+#include "logger.h"
+
+/* Read-mostly throughput of rwlock_t and brlock_t against pthread_rwlock_t: ./rwlock_bench [-n ops] [-t max threads] */
+
+enum bench_lock { BENCH_RWLOCK, BENCH_BRLOCK, BENCH_PTHREAD };
+
+static const char *bench_names[] = { "rwlock", "brlock", "pthread" };
+
+struct bench_arg {
+    enum bench_lock kind;
+    long ops;
+    int write_every; // 0: readers only
+    long done;
+    long rejected; // -EAGAIN from a waiter limit, retried
+    int failures;  // Other errors; the op is dropped and not counted as done
+};
+
+static rwlock_t lock;
+static brlock_t brlock;
+static pthread_rwlock_t plock;
+static volatile long shared_value;
+
+static void *bench_thread(void *arg) {
+    struct bench_arg *b = (struct bench_arg *)arg;
+    for (long i = 0; i < b->ops; i++) {
+        int write = b->write_every && i % b->write_every == 0;
+        int ret;
+        for (;;) {
+            if (b->kind == BENCH_PTHREAD) ret = write ? pthread_rwlock_wrlock(&plock) : pthread_rwlock_rdlock(&plock);
+            else if (b->kind == BENCH_BRLOCK) ret = write ? brlock_wrlock(&brlock) : brlock_rdlock(&brlock);
+            else ret = write ? rwlock_wrlock(&lock) : rwlock_rdlock(&lock);
+            if (ret != -EAGAIN) break;
+            b->rejected++;
+            sched_yield();
+        }
+        if (ret != 0) {
+            b->failures++;
+            continue;
+        }
+        if (write) shared_value++;
+        else (void)shared_value;
+        if (b->kind == BENCH_PTHREAD) pthread_rwlock_unlock(&plock);
+        else if (b->kind == BENCH_BRLOCK) brlock_unlock(&brlock);
+        else rwlock_unlock(&lock);
+        b->done++;
+    }
+    return NULL;
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_run(enum bench_lock kind, int threads, long ops, int write_every) {
+    pthread_t tids[threads];
+    struct bench_arg args[threads];
+    long done = 0, rejected = 0;
+    int failures = 0;
+
+    double start = bench_now();
+    for (int i = 0; i < threads; i++) {
+        args[i] = (struct bench_arg){ .kind = kind, .ops = ops / threads, .write_every = write_every };
+        pthread_create(&tids[i], NULL, bench_thread, &args[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+        done += args[i].done;
+        rejected += args[i].rejected;
+        failures += args[i].failures;
+    }
+    double elapsed = bench_now() - start;
+    char mix[32];
+    if (write_every) snprintf(mix, sizeof(mix), "1/%d writes", write_every);
+    else snprintf(mix, sizeof(mix), "reads only");
+    printf("%-8s %2d threads %-12s %8.1f ns/op %8.2f M ops/s", bench_names[kind], threads, mix,
+           elapsed * 1e9 / done, done / elapsed / 1e6);
+    if (rejected) printf("  %ld rejected with -EAGAIN and retried", rejected);
+    if (failures) printf("  %d failed", failures);
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    long ops = 4000000;
+    int max_threads = 8;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ops = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            max_threads = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-n ops] [-t max threads]\n", argv[0]);
+            return 1;
+        }
+    }
+    logger_init("rwlock_bench.log");
+    logger_set_level(LOG_WARNING);
+    rwlock_init(&lock);
+    brlock_init(&brlock);
+    pthread_rwlock_init(&plock, NULL);
+
+    const int mixes[] = { 0, 1000, 100 };
+    for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++) {
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            bench_run(BENCH_RWLOCK, threads, ops, mixes[m]);
+            bench_run(BENCH_BRLOCK, threads, ops, mixes[m]);
+            bench_run(BENCH_PTHREAD, threads, ops, mixes[m]);
+        }
+    }
+
+    pthread_rwlock_destroy(&plock);
+    brlock_destroy(&brlock);
+    rwlock_destroy(&lock);
+    logger_destroy();
+    return 0;
+}
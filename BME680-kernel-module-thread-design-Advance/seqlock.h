@@ -0,0 +1,101 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "sync_util.h"
+
+/*
+ * Sequence lock for small, frequently read values. A writer makes the counter odd,
+ * updates the data and makes it even again; a reader copies the data between two reads
+ * of the counter and retries if it was odd or changed. Readers never write shared memory
+ * and never block, so any number of them poll without slowing each other or the writer.
+ * Writers serialize among themselves by spinning on the counter, so keep updates short.
+ *
+ * The data is copied as relaxed atomic words, so a torn copy is discarded rather than
+ * being a data race.
+ */
+typedef struct seqlock {
+    atomic_uint seq;
+} seqlock_t;
+
+static inline void seqlock_init(seqlock_t *sl) {
+    atomic_init(&sl->seq, 0);
+}
+
+/* Waits out a writer in progress; pass the result to seqlock_read_retry() */
+static inline unsigned seqlock_read_begin(const seqlock_t *sl) {
+    unsigned seq;
+    while ((seq = atomic_load_explicit(&sl->seq, memory_order_acquire)) & 1) cpu_relax();
+    return seq;
+}
+
+/* Nonzero if a writer ran since seqlock_read_begin() and the copy must be redone */
+static inline int seqlock_read_retry(const seqlock_t *sl, unsigned seq) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&sl->seq, memory_order_relaxed) != seq;
+}
+
+static inline void seqlock_write_begin(seqlock_t *sl) {
+    unsigned seq = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+    for (;;) {
+        if (!(seq & 1) && atomic_compare_exchange_weak_explicit(&sl->seq, &seq, seq + 1,
+                                                                memory_order_acquire, memory_order_relaxed))
+            break;
+        cpu_relax();
+        seq = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release); // Odd count is visible before any data store
+}
+
+static inline void seqlock_write_end(seqlock_t *sl) {
+    atomic_fetch_add_explicit(&sl->seq, 1, memory_order_release);
+}
+
+#define SEQLOCK_WORDS(type) ((sizeof(type) + sizeof(unsigned long) - 1) / sizeof(unsigned long))
+
+static inline void seqlock_load_words(unsigned long *dst, const unsigned long *src, size_t n) {
+    for (size_t i = 0; i < n; i++) dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+}
+
+static inline void seqlock_store_words(unsigned long *dst, const unsigned long *src, size_t n) {
+    for (size_t i = 0; i < n; i++) __atomic_store_n(&dst[i], src[i], __ATOMIC_RELAXED);
+}
+
+/*
+ * SEQLOCK_CELL(name, type) defines struct name, a latest-value cell for a small POD type:
+ *   void name_init(struct name *c)                      zero value, generation 0
+ *   void name_store(struct name *c, const type *v)      publish a new value
+ *   unsigned name_load(const struct name *c, type *out) copy the current value out; returns
+ *                                                       how many stores it reflects, so a
+ *                                                       poller can skip unchanged values
+ */
+#define SEQLOCK_CELL(name, type)                                                              \
+    struct name {                                                                             \
+        seqlock_t lock;                                                                       \
+        unsigned long words[SEQLOCK_WORDS(type)];                                             \
+    };                                                                                        \
+    static inline void name##_init(struct name *c) {                                          \
+        seqlock_init(&c->lock);                                                               \
+        memset(c->words, 0, sizeof(c->words));                                                \
+    }                                                                                         \
+    static inline void name##_store(struct name *c, const type *v) {                          \
+        unsigned long buf[SEQLOCK_WORDS(type)] = { 0 };                                       \
+        memcpy(buf, v, sizeof(type));                                                         \
+        seqlock_write_begin(&c->lock);                                                        \
+        seqlock_store_words(c->words, buf, SEQLOCK_WORDS(type));                              \
+        seqlock_write_end(&c->lock);                                                          \
+    }                                                                                         \
+    static inline unsigned name##_load(const struct name *c, type *out) {                     \
+        unsigned long buf[SEQLOCK_WORDS(type)];                                               \
+        unsigned seq;                                                                         \
+        do {                                                                                  \
+            seq = seqlock_read_begin(&c->lock);                                               \
+            seqlock_load_words(buf, c->words, SEQLOCK_WORDS(type));                           \
+        } while (seqlock_read_retry(&c->lock, seq));                                          \
+        memcpy(out, buf, sizeof(type));                                                       \
+        return seq / 2;                                                                       \
+    }
+
+#endif /* SEQLOCK_H */
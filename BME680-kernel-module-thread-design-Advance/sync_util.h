@@ -0,0 +1,51 @@
+#ifndef SYNC_UTIL_H
+#define SYNC_UTIL_H
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/* Shared helpers for the lock-free structures */
+
+#define CACHE_LINE_SIZE 64
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/* Absolute CLOCK_MONOTONIC deadline timeout_ms from now */
+static inline void deadline_from_ms(struct timespec *ts, int timeout_ms) {
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+/*
+ * Sleep while *addr == val. deadline is an absolute CLOCK_MONOTONIC time, NULL waits forever.
+ * Returns 0 on wake-up (possibly spurious), -EAGAIN if *addr != val, -ETIMEDOUT on deadline.
+ */
+static inline int futex_wait(atomic_int *addr, int val, const struct timespec *deadline) {
+    if (syscall(SYS_futex, addr, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, val,
+                deadline, NULL, FUTEX_BITSET_MATCH_ANY) == 0)
+        return 0;
+    return errno == EINTR ? 0 : -errno;
+}
+
+static inline int futex_wake(atomic_int *addr, int count) {
+    return (int)syscall(SYS_futex, addr, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count, NULL, NULL, 0);
+}
+
+#endif /* SYNC_UTIL_H */
@@ -1,158 +1,1027 @@
+#define _GNU_SOURCE // CPU_SET, sched_getcpu, pthread_setaffinity_np
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <sched.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <time.h>
+#include <limits.h>
 #include "thread_pool.h"
 #include "logger.h"
-#include "barrier.h"
-#include "event_pair.h"
+#include "sync_util.h"
+
+#define THREAD_POOL_QUEUE_SIZE 1024 // Must be a power of two
+#define THREAD_POOL_DEQUE_SIZE 256
+#define THREAD_POOL_INBOX_SIZE 256
+#define THREAD_POOL_NORMAL_WEIGHT 8        // Normal tasks served per background task
+#define THREAD_POOL_AGING_NS 500000000ULL  // A lane waiting longer than this is served next
+#define THREAD_POOL_CONTROL_PERIOD_MS 50   // Elastic mode: how often queue latency is sampled
+#define THREAD_POOL_SPAWN_WAIT_US 2000     // Elastic mode defaults
+#define THREAD_POOL_RETIRE_IDLE_MS 30000
 
 struct task {
     void (*func)(void *);
     void *arg;
-    struct task *next;
+    struct thread_pool_group *group;
+    uint64_t enqueue_ns;
+    int prio;
 };
 
-struct thread_pool {
-    pthread_t *threads;
-    int num_threads;
-    struct task *head;
-    struct task *tail;
+/* Opt-in batch synchronization: counts tasks still outstanding in the group */
+struct thread_pool_group {
+    atomic_int pending;
     pthread_mutex_t mutex;
     pthread_cond_t cond;
-    barrier_t *barrier;
-    event_pair_t *ep;
+};
+
+/* Bounded MPMC queue (Vyukov): each slot carries its own sequence number */
+struct task_slot {
+    atomic_size_t seq;
+    struct task task;
+};
+
+struct task_ring {
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t head;
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+    _Alignas(CACHE_LINE_SIZE) struct task_slot *slots;
+    size_t mask;
+};
+
+/* Chase-Lev work-stealing deque: the owner pushes/pops at the bottom, thieves steal from the top */
+struct ws_deque {
+    _Alignas(CACHE_LINE_SIZE) atomic_long top;
+    _Alignas(CACHE_LINE_SIZE) atomic_long bottom;
+    struct task *buf;
+    long mask;
+};
+
+/* One queue per priority, each with its own depth and wait-time counters */
+struct lane {
+    struct task_ring ring;
+    _Alignas(CACHE_LINE_SIZE) atomic_int depth;
+    atomic_ullong waiting_since_ns; // Set when the lane goes from empty to non-empty, or is served
+    atomic_ullong enqueued;
+    atomic_ullong dequeued;
+    atomic_ullong rejected;
+    atomic_ullong wait_ns_total;
+    atomic_ullong wait_ns_max;
+};
+
+/* Written only by the owning worker (load + store, no RMW), read by thread_pool_get_stats() */
+struct worker_metrics {
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong tasks;
+    atomic_ullong busy_ns;
+    atomic_ullong idle_ns;
+    atomic_ullong steals;
+    atomic_ullong wait_hist[THREAD_POOL_HIST_BUCKETS];
+    atomic_ullong run_hist[THREAD_POOL_HIST_BUCKETS];
+};
+
+struct worker {
+    struct ws_deque deque;
+    struct task_ring inbox; // Affine tasks, only drained by the owner
+    struct thread_pool *tp;
+    pthread_t thread;
+    pthread_cond_t cond;
+    int id;
+    int parked; // Protected by tp->mutex
+    atomic_int active; // Slot has a running worker that takes work
+    int started;       // Thread created and not joined yet; only touched by the spawning thread
+    unsigned int seed;
+    unsigned int normal_streak;
+    struct worker_metrics metrics;
+};
+
+struct thread_pool {
+    struct lane lanes[THREAD_POOL_NUM_PRIO];
+    struct worker *workers;
+    int num_threads; // Worker slots (max_threads in elastic mode)
+    enum thread_pool_mode mode;
+    int elastic;
+    int min_threads;
+    uint64_t spawn_wait_ns;
+    int retire_idle_ms;
+    atomic_int live_threads;
+    pthread_t controller;
+    int controller_started;
+    _Alignas(CACHE_LINE_SIZE) atomic_int idle_workers;
+    pthread_mutex_t mutex;
+    int *idle_stack; // Parked worker ids, protected by mutex
+    int idle_top;
+    _Alignas(CACHE_LINE_SIZE) atomic_int pending; // Enqueued but not yet finished
+    atomic_int idle_waiters;
     volatile int shutdown;
 };
 
-static void task_cleanup(void *arg) {
-    struct task *task = (struct task *)arg;
-    logger_log(LOG_INFO, "Task cleanup: freeing task");
-    free(task);
+static __thread struct worker *current_worker;
+
+static int task_ring_init(struct task_ring *ring, size_t size) {
+    ring->slots = malloc(size * sizeof(struct task_slot));
+    if (!ring->slots) return -ENOMEM;
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&ring->slots[i].seq, i);
+    }
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 0;
+}
+
+static void task_ring_destroy(struct task_ring *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+static int task_ring_push(struct task_ring *ring, const struct task *task) {
+    size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    struct task_slot *slot;
+    for (;;) {
+        slot = &ring->slots[pos & ring->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (dif < 0) {
+            return -EAGAIN; // Full
+        } else {
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+    slot->task = *task;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    return 0;
+}
+
+/* Reserve n consecutive slots with a single CAS; all-or-nothing */
+static int task_ring_push_batch(struct task_ring *ring, const struct task *tasks, int n) {
+    if ((size_t)n > ring->mask + 1) return -EAGAIN;
+    size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    for (;;) {
+        int i;
+        for (i = 0; i < n; i++) {
+            size_t seq = atomic_load_explicit(&ring->slots[(pos + i) & ring->mask].seq, memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + i);
+            if (dif < 0) return -EAGAIN; // Not enough room
+            if (dif > 0) break;          // Another producer got ahead, retry
+        }
+        if (i == n && atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + n,
+                                                            memory_order_relaxed, memory_order_relaxed))
+            break;
+        if (i != n) pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    }
+    for (int i = 0; i < n; i++) {
+        struct task_slot *slot = &ring->slots[(pos + i) & ring->mask];
+        slot->task = tasks[i];
+        atomic_store_explicit(&slot->seq, pos + i + 1, memory_order_release);
+    }
+    return 0;
+}
+
+static int task_ring_pop(struct task_ring *ring, struct task *task) {
+    size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    struct task_slot *slot;
+    for (;;) {
+        slot = &ring->slots[pos & ring->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (dif < 0) {
+            return -EAGAIN; // Empty
+        } else {
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+    *task = slot->task;
+    atomic_store_explicit(&slot->seq, pos + ring->mask + 1, memory_order_release);
+    return 0;
+}
+
+static uint64_t thread_pool_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void metric_add(atomic_ullong *counter, uint64_t v) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+static inline int hist_bucket(uint64_t ns) {
+    int b = ns ? 63 - __builtin_clzll(ns) : 0;
+    return b < THREAD_POOL_HIST_BUCKETS ? b : THREAD_POOL_HIST_BUCKETS - 1;
+}
+
+static int lane_push(struct lane *lane, const struct task *task) {
+    if (task_ring_push(&lane->ring, task) != 0) return -EAGAIN;
+    if (atomic_fetch_add_explicit(&lane->depth, 1, memory_order_relaxed) == 0) {
+        atomic_store_explicit(&lane->waiting_since_ns, task->enqueue_ns, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&lane->enqueued, 1, memory_order_relaxed);
+    return 0;
+}
+
+static int lane_push_batch(struct lane *lane, const struct task *tasks, int n) {
+    if (task_ring_push_batch(&lane->ring, tasks, n) != 0) return -EAGAIN;
+    if (atomic_fetch_add_explicit(&lane->depth, n, memory_order_relaxed) == 0) {
+        atomic_store_explicit(&lane->waiting_since_ns, tasks[0].enqueue_ns, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&lane->enqueued, n, memory_order_relaxed);
+    return 0;
+}
+
+static int lane_pop(struct lane *lane, struct task *task, uint64_t now) {
+    if (task_ring_pop(&lane->ring, task) != 0) return -EAGAIN;
+    atomic_fetch_sub_explicit(&lane->depth, 1, memory_order_relaxed);
+    atomic_store_explicit(&lane->waiting_since_ns, now, memory_order_relaxed);
+    atomic_fetch_add_explicit(&lane->dequeued, 1, memory_order_relaxed);
+    uint64_t wait = now > task->enqueue_ns ? now - task->enqueue_ns : 0;
+    atomic_fetch_add_explicit(&lane->wait_ns_total, wait, memory_order_relaxed);
+    unsigned long long max = atomic_load_explicit(&lane->wait_ns_max, memory_order_relaxed);
+    while (wait > max && !atomic_compare_exchange_weak_explicit(&lane->wait_ns_max, &max, wait,
+                                                               memory_order_relaxed, memory_order_relaxed))
+        ;
+    return 0;
+}
+
+static int lane_starved(struct lane *lane, uint64_t now) {
+    if (atomic_load_explicit(&lane->depth, memory_order_relaxed) <= 0) return 0;
+    uint64_t since = atomic_load_explicit(&lane->waiting_since_ns, memory_order_relaxed);
+    return now > since && now - since > THREAD_POOL_AGING_NS;
+}
+
+static int ws_deque_init(struct ws_deque *dq, long size) {
+    dq->buf = malloc(size * sizeof(struct task));
+    if (!dq->buf) return -ENOMEM;
+    dq->mask = size - 1;
+    atomic_init(&dq->top, 0);
+    atomic_init(&dq->bottom, 0);
+    return 0;
+}
+
+static void ws_deque_destroy(struct ws_deque *dq) {
+    free(dq->buf);
+    dq->buf = NULL;
+}
+
+/* Owner only */
+static int ws_deque_push(struct ws_deque *dq, const struct task *task) {
+    long b = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    if (b - t > dq->mask) return -EAGAIN; // Full
+    dq->buf[b & dq->mask] = *task;
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+    return 0;
+}
+
+/* Owner only */
+static int ws_deque_pop(struct ws_deque *dq, struct task *task) {
+    long b = atomic_load_explicit(&dq->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&dq->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&dq->top, memory_order_relaxed);
+    if (t > b) {
+        atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+        return -EAGAIN; // Empty
+    }
+    *task = dq->buf[b & dq->mask];
+    if (t == b) {
+        /* Last element: race against thieves for it */
+        int won = atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1,
+                                                          memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+        if (!won) return -EAGAIN;
+    }
+    return 0;
+}
+
+/* Any thread; the slot copy may race with the owner but is discarded if the CAS fails */
+static int ws_deque_steal(struct ws_deque *dq, struct task *task) {
+    long t = atomic_load_explicit(&dq->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+    if (t >= b) return -EAGAIN; // Empty
+    *task = dq->buf[t & dq->mask];
+    if (!atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed))
+        return -EAGAIN; // Lost the race
+    return 0;
+}
+
+static struct worker *current_worker_of(struct thread_pool *tp) {
+    struct worker *w = current_worker;
+    return (w && w->tp == tp) ? w : NULL;
+}
+
+/* Called with tp->mutex held */
+static void worker_unpark_locked(struct worker *w) {
+    struct thread_pool *tp = w->tp;
+    if (!w->parked) return;
+    for (int i = 0; i < tp->idle_top; i++) {
+        if (tp->idle_stack[i] == w->id) {
+            tp->idle_stack[i] = tp->idle_stack[--tp->idle_top];
+            break;
+        }
+    }
+    w->parked = 0;
+    atomic_fetch_sub(&tp->idle_workers, 1);
+}
+
+/* Wake any parked worker; free when nobody is parked */
+static void thread_pool_wake_one(struct thread_pool *tp) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&tp->idle_workers, memory_order_relaxed) == 0) return;
+    pthread_mutex_lock(&tp->mutex);
+    if (tp->idle_top > 0) {
+        struct worker *w = &tp->workers[tp->idle_stack[tp->idle_top - 1]];
+        worker_unpark_locked(w);
+        pthread_cond_signal(&w->cond);
+    }
+    pthread_mutex_unlock(&tp->mutex);
+}
+
+/* Wake up to n parked workers under a single lock */
+static void thread_pool_wake_many(struct thread_pool *tp, int n) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&tp->idle_workers, memory_order_relaxed) == 0) return;
+    pthread_mutex_lock(&tp->mutex);
+    while (n-- > 0 && tp->idle_top > 0) {
+        struct worker *w = &tp->workers[tp->idle_stack[tp->idle_top - 1]];
+        worker_unpark_locked(w);
+        pthread_cond_signal(&w->cond);
+    }
+    pthread_mutex_unlock(&tp->mutex);
+}
+
+/* Wake a specific worker if it is parked */
+static void thread_pool_wake_worker(struct thread_pool *tp, struct worker *w) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&tp->idle_workers, memory_order_relaxed) == 0) return;
+    pthread_mutex_lock(&tp->mutex);
+    if (w->parked) {
+        worker_unpark_locked(w);
+        pthread_cond_signal(&w->cond);
+    }
+    pthread_mutex_unlock(&tp->mutex);
+}
+
+/*
+ * Critical lane first (strict), then any lane that has aged past THREAD_POOL_AGING_NS,
+ * then the local deque and inbox, then normal/background weighted THREAD_POOL_NORMAL_WEIGHT:1,
+ * and finally steal from a random victim.
+ */
+static int worker_find_task(struct worker *w, struct task *task) {
+    struct thread_pool *tp = w->tp;
+    uint64_t now = thread_pool_now_ns();
+    struct lane *normal = &tp->lanes[THREAD_POOL_PRIO_NORMAL];
+    struct lane *background = &tp->lanes[THREAD_POOL_PRIO_BACKGROUND];
+
+    if (lane_pop(&tp->lanes[THREAD_POOL_PRIO_CRITICAL], task, now) == 0) return 0;
+    if (lane_starved(background, now) && lane_pop(background, task, now) == 0) {
+        w->normal_streak = 0;
+        return 0;
+    }
+    if (lane_starved(normal, now) && lane_pop(normal, task, now) == 0) return 0;
+    if (tp->mode == THREAD_POOL_WORK_STEALING) {
+        if (ws_deque_pop(&w->deque, task) == 0) return 0;
+        if (task_ring_pop(&w->inbox, task) == 0) return 0;
+    }
+    if (w->normal_streak >= THREAD_POOL_NORMAL_WEIGHT) {
+        w->normal_streak = 0;
+        if (lane_pop(background, task, now) == 0) return 0;
+    }
+    if (lane_pop(normal, task, now) == 0) {
+        w->normal_streak++;
+        return 0;
+    }
+    if (lane_pop(background, task, now) == 0) {
+        w->normal_streak = 0;
+        return 0;
+    }
+    if (tp->mode == THREAD_POOL_WORK_STEALING && tp->num_threads > 1) {
+        int start = rand_r(&w->seed) % tp->num_threads;
+        for (int i = 0; i < tp->num_threads; i++) {
+            struct worker *victim = &tp->workers[(start + i) % tp->num_threads];
+            if (victim == w || !atomic_load_explicit(&victim->active, memory_order_relaxed)) continue;
+            if (ws_deque_steal(&victim->deque, task) == 0) {
+                metric_add(&w->metrics.steals, 1);
+                LOGD("Worker %d stole task from worker %d", w->id, victim->id);
+                return 0;
+            }
+        }
+    }
+    return -EAGAIN;
+}
+
+/* Elastic mode: give up this worker if the pool stays above min_threads */
+static int thread_pool_try_retire(struct thread_pool *tp) {
+    int live = atomic_load(&tp->live_threads);
+    while (live > tp->min_threads) {
+        if (atomic_compare_exchange_weak(&tp->live_threads, &live, live - 1)) return 1;
+    }
+    return 0;
+}
+
+/*
+ * Sleep until woken by a producer; rechecks all sources after registering as idle.
+ * Returns -ECANCELED when an elastic worker has been idle long enough to retire.
+ */
+static int worker_park(struct worker *w, struct task *task) {
+    struct thread_pool *tp = w->tp;
+    struct timespec ts;
+    deadline_from_ms(&ts, tp->elastic ? tp->retire_idle_ms : 5000);
+
+    pthread_mutex_lock(&tp->mutex);
+    if (tp->shutdown) {
+        pthread_mutex_unlock(&tp->mutex);
+        return -ESHUTDOWN;
+    }
+    w->parked = 1;
+    tp->idle_stack[tp->idle_top++] = w->id;
+    atomic_fetch_add(&tp->idle_workers, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (worker_find_task(w, task) == 0) {
+        worker_unpark_locked(w);
+        pthread_mutex_unlock(&tp->mutex);
+        return 0;
+    }
+    int ret = 0;
+    while (w->parked && !tp->shutdown) {
+        ret = pthread_cond_timedwait(&w->cond, &tp->mutex, &ts);
+        if (ret == ETIMEDOUT) {
+            ret = 0;
+            if (tp->elastic) {
+                if (w->parked && thread_pool_try_retire(tp)) {
+                    worker_unpark_locked(w);
+                    pthread_mutex_unlock(&tp->mutex);
+                    return -ECANCELED;
+                }
+            } else {
+                LOGW("Worker thread timed out waiting for tasks");
+            }
+            break;
+        }
+        if (ret != 0) break;
+    }
+    worker_unpark_locked(w);
+    int shutdown = tp->shutdown;
+    pthread_mutex_unlock(&tp->mutex);
+    if (ret != 0) {
+        LOGE("Worker thread wait failed: %s", strerror(ret));
+        return -ret;
+    }
+    return shutdown ? -ESHUTDOWN : -EAGAIN;
+}
+
+/*
+ * The last task drops pending to 0 under group->mutex, so a waiter (which reads pending
+ * under the mutex) cannot return and destroy the group before this thread is done with it.
+ */
+static void thread_pool_group_done(struct thread_pool_group *group) {
+    int pending = atomic_load(&group->pending);
+    while (pending > 1) {
+        if (atomic_compare_exchange_weak(&group->pending, &pending, pending - 1)) return;
+    }
+    pthread_mutex_lock(&group->mutex);
+    if (atomic_fetch_sub(&group->pending, 1) == 1) pthread_cond_broadcast(&group->cond);
+    pthread_mutex_unlock(&group->mutex);
+}
+
+static void thread_pool_task_finished(struct thread_pool *tp, int n) {
+    if (atomic_fetch_sub(&tp->pending, n) == n && atomic_load(&tp->idle_waiters) > 0) {
+        futex_wake(&tp->pending, INT_MAX);
+    }
+}
+
+static void future_run(void *arg) {
+    thread_pool_future_t *fut = (thread_pool_future_t *)arg;
+    fut->result = fut->func(fut->arg);
+    if (atomic_exchange(&fut->state, THREAD_POOL_FUTURE_DONE) == THREAD_POOL_FUTURE_WAITING) {
+        futex_wake(&fut->state, INT_MAX);
+    }
+}
+
+/* Hand anything left in a retiring worker's inbox back to the normal lane */
+static void worker_retire(struct worker *w) {
+    struct thread_pool *tp = w->tp;
+    struct task task;
+    atomic_store(&w->active, 0);
+    while (tp->mode == THREAD_POOL_WORK_STEALING && task_ring_pop(&w->inbox, &task) == 0) {
+        while (lane_push(&tp->lanes[THREAD_POOL_PRIO_NORMAL], &task) != 0) sched_yield();
+        thread_pool_wake_one(tp);
+    }
+    LOGI("Worker %d retired, %d threads live", w->id, atomic_load(&tp->live_threads));
 }
 
 static void *worker_thread(void *arg) {
-    struct thread_pool *tp = (struct thread_pool *)arg;
+    struct worker *w = (struct worker *)arg;
+    struct thread_pool *tp = w->tp;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
     cpu_set_t cpuset;
     CPU_ZERO(&cpuset);
-    CPU_SET(sched_getcpu() % sysconf(_SC_NPROCESSORS_ONLN), &cpuset);
+    if (tp->mode == THREAD_POOL_WORK_STEALING) {
+        CPU_SET(w->id % ncpu, &cpuset); // One worker per core keeps its deque cache-hot
+    } else {
+        CPU_SET(sched_getcpu() % ncpu, &cpuset);
+    }
     pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    current_worker = w;
+
+    struct worker_metrics *m = &w->metrics;
+    uint64_t idle_start = thread_pool_now_ns();
+    while (!tp->shutdown) {
+        struct task task;
+        if (worker_find_task(w, &task) != 0) {
+            int ret = worker_park(w, &task);
+            if (ret == -EAGAIN) continue;
+            if (ret == -ECANCELED) worker_retire(w);
+            if (ret != 0) break;
+        }
+        uint64_t start = thread_pool_now_ns();
+        metric_add(&m->idle_ns, start - idle_start);
+        metric_add(&m->wait_hist[hist_bucket(start > task.enqueue_ns ? start - task.enqueue_ns : 0)], 1);
+        if (task.func) task.func(task.arg);
+        if (task.group) thread_pool_group_done(task.group);
+        idle_start = thread_pool_now_ns();
+        metric_add(&m->busy_ns, idle_start - start);
+        metric_add(&m->run_hist[hist_bucket(idle_start - start)], 1);
+        metric_add(&m->tasks, 1);
+        thread_pool_task_finished(tp, 1);
+    }
+    current_worker = NULL;
+    return NULL;
+}
+
+static void thread_pool_free(struct thread_pool *tp) {
+    if (tp->workers) {
+        for (int i = 0; i < tp->num_threads; i++) {
+            ws_deque_destroy(&tp->workers[i].deque);
+            task_ring_destroy(&tp->workers[i].inbox);
+            pthread_cond_destroy(&tp->workers[i].cond);
+        }
+        free(tp->workers);
+    }
+    for (int i = 0; i < THREAD_POOL_NUM_PRIO; i++) {
+        task_ring_destroy(&tp->lanes[i].ring);
+    }
+    free(tp->idle_stack);
+    free(tp);
+}
+
+static int thread_pool_spawn_worker(struct thread_pool *tp, struct worker *w) {
+    if (w->started) {
+        pthread_join(w->thread, NULL); // Reap the retired thread that owned this slot
+        w->started = 0;
+    }
+    atomic_store(&w->active, 1);
+    atomic_fetch_add(&tp->live_threads, 1);
+    if (pthread_create(&w->thread, NULL, worker_thread, w) != 0) {
+        atomic_store(&w->active, 0);
+        atomic_fetch_sub(&tp->live_threads, 1);
+        LOGE("Failed to create thread %d", w->id);
+        return -EAGAIN;
+    }
+    w->started = 1;
+    return 0;
+}
+
+/* Elastic mode: add a worker when measured queue wait exceeds spawn_wait_ns and nobody is idle */
+static void *thread_pool_controller(void *arg) {
+    struct thread_pool *tp = (struct thread_pool *)arg;
+    uint64_t last_total[THREAD_POOL_NUM_PRIO] = {0};
+    uint64_t last_dequeued[THREAD_POOL_NUM_PRIO] = {0};
+    struct timespec period = { .tv_sec = 0, .tv_nsec = THREAD_POOL_CONTROL_PERIOD_MS * 1000000L };
 
     while (!tp->shutdown) {
-        struct timespec ts;
-        clock_gettime(CLOCK_MONOTONIC, &ts);
-        ts.tv_sec += 5;
-        pthread_mutex_lock(&tp->mutex);
-        while (!tp->head && !tp->shutdown) {
-            int ret = pthread_cond_timedwait(&tp->cond, &tp->mutex, &ts);
-            if (ret == ETIMEDOUT) {
-                pthread_mutex_unlock(&tp->mutex);
-                logger_log(LOG_WARNING, "Worker thread timed out waiting for tasks");
-                continue;
+        clock_nanosleep(CLOCK_MONOTONIC, 0, &period, NULL);
+        uint64_t now = thread_pool_now_ns();
+        uint64_t wait = 0;
+        for (int i = 0; i < THREAD_POOL_NUM_PRIO; i++) {
+            struct lane *lane = &tp->lanes[i];
+            uint64_t total = atomic_load_explicit(&lane->wait_ns_total, memory_order_relaxed);
+            uint64_t dequeued = atomic_load_explicit(&lane->dequeued, memory_order_relaxed);
+            if (dequeued > last_dequeued[i]) {
+                uint64_t avg = (total - last_total[i]) / (dequeued - last_dequeued[i]);
+                if (avg > wait) wait = avg;
             }
-            if (ret != 0) {
-                pthread_mutex_unlock(&tp->mutex);
-                logger_log(LOG_ERROR, "Worker thread wait failed: %s", strerror(ret));
-                return NULL;
+            last_total[i] = total;
+            last_dequeued[i] = dequeued;
+            /* Catch queues that are not draining at all */
+            if (atomic_load_explicit(&lane->depth, memory_order_relaxed) > 0) {
+                uint64_t since = atomic_load_explicit(&lane->waiting_since_ns, memory_order_relaxed);
+                if (now > since && now - since > wait) wait = now - since;
             }
         }
-        if (tp->shutdown) {
-            pthread_mutex_unlock(&tp->mutex);
+        if (wait <= tp->spawn_wait_ns || tp->shutdown ||
+            atomic_load(&tp->idle_workers) > 0 || atomic_load(&tp->live_threads) >= tp->num_threads)
+            continue;
+        for (int i = 0; i < tp->num_threads; i++) {
+            struct worker *w = &tp->workers[i];
+            if (atomic_load(&w->active)) continue;
+            if (thread_pool_spawn_worker(tp, w) == 0) {
+                LOGI("Queue wait %llu us, spawned worker %d (%d threads live)",
+                     (unsigned long long)(wait / 1000), w->id, atomic_load(&tp->live_threads));
+            }
             break;
         }
-        struct task *task = tp->head;
-        if (task) {
-            tp->head = task->next;
-            if (!tp->head) tp->tail = NULL;
-        }
-        pthread_mutex_unlock(&tp->mutex);
-        if (task) {
-            pthread_cleanup_push(task_cleanup, task); // Cleanup if canceled
-            barrier_wait(tp->barrier);
-            if (task->func) task->func(task->arg);
-            event_pair_signal1(tp->ep);
-            event_pair_wait2(tp->ep);
-            pthread_cleanup_pop(0);
-            free(task);
-        }
     }
     return NULL;
 }
 
+static void thread_pool_stop(struct thread_pool *tp) {
+    pthread_mutex_lock(&tp->mutex);
+    tp->shutdown = 1;
+    pthread_mutex_unlock(&tp->mutex);
+    if (tp->controller_started) pthread_join(tp->controller, NULL);
+    pthread_mutex_lock(&tp->mutex);
+    for (int i = 0; i < tp->num_threads; i++) {
+        pthread_cond_signal(&tp->workers[i].cond);
+    }
+    pthread_mutex_unlock(&tp->mutex);
+    for (int i = 0; i < tp->num_threads; i++) {
+        if (tp->workers[i].started) pthread_join(tp->workers[i].thread, NULL);
+    }
+    pthread_mutex_destroy(&tp->mutex);
+}
+
 int thread_pool_init(struct thread_pool **tp, int num_threads) {
-    *tp = malloc(sizeof(struct thread_pool));
+    return thread_pool_init_attr(tp, num_threads, NULL);
+}
+
+int thread_pool_init_attr(struct thread_pool **tp, int num_threads, const struct thread_pool_attr *attr) {
+    enum thread_pool_mode mode = attr ? attr->mode : THREAD_POOL_SHARED_QUEUE;
+    int elastic = attr && attr->max_threads > 0;
+    int min_threads = elastic ? attr->min_threads : num_threads;
+    int max_threads = elastic ? attr->max_threads : num_threads;
+    if (num_threads <= 0 || min_threads <= 0 || min_threads > max_threads ||
+        (mode != THREAD_POOL_SHARED_QUEUE && mode != THREAD_POOL_WORK_STEALING)) {
+        LOGE("Invalid thread pool parameters: threads=%d, min=%d, max=%d, mode=%d",
+             num_threads, min_threads, max_threads, mode);
+        return -EINVAL;
+    }
+    if (num_threads < min_threads) num_threads = min_threads;
+    if (num_threads > max_threads) num_threads = max_threads;
+    *tp = aligned_alloc(CACHE_LINE_SIZE, sizeof(struct thread_pool));
     if (!*tp) return -ENOMEM;
-    (*tp)->threads = malloc(num_threads * sizeof(pthread_t));
-    if (!(*tp)->threads) {
-        free(*tp);
+    memset(*tp, 0, sizeof(struct thread_pool));
+    (*tp)->num_threads = max_threads;
+    (*tp)->mode = mode;
+    (*tp)->elastic = elastic;
+    (*tp)->min_threads = min_threads;
+    (*tp)->spawn_wait_ns = (uint64_t)(elastic && attr->spawn_wait_us > 0 ? attr->spawn_wait_us : THREAD_POOL_SPAWN_WAIT_US) * 1000;
+    (*tp)->retire_idle_ms = elastic && attr->retire_idle_ms > 0 ? attr->retire_idle_ms : THREAD_POOL_RETIRE_IDLE_MS;
+    (*tp)->workers = aligned_alloc(CACHE_LINE_SIZE, max_threads * sizeof(struct worker));
+    (*tp)->idle_stack = malloc(max_threads * sizeof(int));
+    int lanes_ok = 1;
+    for (int i = 0; i < THREAD_POOL_NUM_PRIO; i++) {
+        if (task_ring_init(&(*tp)->lanes[i].ring, THREAD_POOL_QUEUE_SIZE) != 0) lanes_ok = 0;
+        atomic_init(&(*tp)->lanes[i].waiting_since_ns, thread_pool_now_ns());
+    }
+    if (!(*tp)->workers || !(*tp)->idle_stack || !lanes_ok) {
+        (*tp)->num_threads = 0;
+        thread_pool_free(*tp);
         return -ENOMEM;
     }
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    for (int i = 0; i < max_threads; i++) {
+        struct worker *w = &(*tp)->workers[i];
+        memset(w, 0, sizeof(*w));
+        w->tp = *tp;
+        w->id = i;
+        w->seed = (unsigned int)i * 2654435761u + 1;
+        pthread_cond_init(&w->cond, &cattr);
+        if (mode == THREAD_POOL_WORK_STEALING &&
+            (ws_deque_init(&w->deque, THREAD_POOL_DEQUE_SIZE) != 0 ||
+             task_ring_init(&w->inbox, THREAD_POOL_INBOX_SIZE) != 0)) {
+            pthread_condattr_destroy(&cattr);
+            (*tp)->num_threads = i + 1;
+            thread_pool_free(*tp);
+            return -ENOMEM;
+        }
+    }
+    pthread_condattr_destroy(&cattr);
     pthread_mutex_init(&(*tp)->mutex, NULL);
-    pthread_cond_init(&(*tp)->cond, NULL);
-    barrier_init(&(*tp)->barrier, num_threads + 1);
-    event_pair_init(&(*tp)->ep);
-    (*tp)->num_threads = num_threads;
-    (*tp)->head = NULL;
-    (*tp)->tail = NULL;
+    atomic_init(&(*tp)->idle_workers, 0);
+    atomic_init(&(*tp)->pending, 0);
+    atomic_init(&(*tp)->idle_waiters, 0);
+    atomic_init(&(*tp)->live_threads, 0);
+    (*tp)->idle_top = 0;
     (*tp)->shutdown = 0;
     for (int i = 0; i < num_threads; i++) {
-        if (pthread_create(&(*tp)->threads[i], NULL, worker_thread, *tp) != 0) {
-            logger_log(LOG_ERROR, "Failed to create thread %d", i);
-            thread_pool_destroy(*tp);
+        if (thread_pool_spawn_worker(*tp, &(*tp)->workers[i]) != 0) {
+            thread_pool_stop(*tp);
+            thread_pool_free(*tp);
             return -1;
         }
     }
-    logger_log(LOG_INFO, "Thread pool initialized with %d threads", num_threads);
+    if (elastic) {
+        if (pthread_create(&(*tp)->controller, NULL, thread_pool_controller, *tp) != 0) {
+            LOGE("Failed to create thread pool controller");
+            thread_pool_stop(*tp);
+            thread_pool_free(*tp);
+            return -1;
+        }
+        (*tp)->controller_started = 1;
+        LOGI("Thread pool initialized with %d threads, elastic %d-%d (%s)", num_threads,
+             min_threads, max_threads, mode == THREAD_POOL_WORK_STEALING ? "work-stealing" : "shared queue");
+    } else {
+        LOGI("Thread pool initialized with %d threads (%s)", num_threads,
+             mode == THREAD_POOL_WORK_STEALING ? "work-stealing" : "shared queue");
+    }
     return 0;
 }
 
 void thread_pool_destroy(struct thread_pool *tp) {
-    pthread_mutex_lock(&tp->mutex);
-    tp->shutdown = 1;
-    pthread_cond_broadcast(&tp->cond);
-    pthread_mutex_unlock(&tp->mutex);
-    for (int i = 0; i < tp->num_threads; i++) {
-        pthread_join(tp->threads[i], NULL);
+    thread_pool_stop(tp);
+    thread_pool_free(tp);
+    LOGI("Thread pool destroyed");
+}
+
+static int thread_pool_submit(struct thread_pool *tp, struct task *task) {
+    struct worker *w = current_worker_of(tp);
+    task->enqueue_ns = thread_pool_now_ns();
+    atomic_fetch_add(&tp->pending, 1);
+    if (tp->mode == THREAD_POOL_WORK_STEALING && w && task->prio == THREAD_POOL_PRIO_NORMAL &&
+        ws_deque_push(&w->deque, task) == 0) {
+        thread_pool_wake_one(tp); // Let an idle worker come and steal
+        return 0;
     }
-    struct task *task = tp->head;
-    while (task) {
-        struct task *next = task->next;
-        free(task);
-        task = next;
+    if (lane_push(&tp->lanes[task->prio], task) != 0) {
+        thread_pool_task_finished(tp, 1);
+        atomic_fetch_add_explicit(&tp->lanes[task->prio].rejected, 1, memory_order_relaxed);
+        LOGD("Task queue %d full (%d slots)", task->prio, THREAD_POOL_QUEUE_SIZE);
+        return -EAGAIN;
     }
-    pthread_mutex_destroy(&tp->mutex);
-    pthread_cond_destroy(&tp->cond);
-    barrier_destroy(tp->barrier);
-    event_pair_destroy(tp->ep);
-    free(tp->threads);
-    free(tp);
-    logger_log(LOG_INFO, "Thread pool destroyed");
+    thread_pool_wake_one(tp);
+    return 0;
 }
 
 int thread_pool_enqueue(struct thread_pool *tp, void (*func)(void *), void *arg) {
     if (!func) {
-        logger_log(LOG_ERROR, "Invalid task function");
+        LOGE("Invalid task function");
+        return -EINVAL;
+    }
+    struct task task = { .func = func, .arg = arg, .prio = THREAD_POOL_PRIO_NORMAL };
+    int ret = thread_pool_submit(tp, &task);
+    if (ret == 0) LOGD("Task enqueued");
+    return ret;
+}
+
+int thread_pool_enqueue_prio(struct thread_pool *tp, enum thread_pool_prio prio, void (*func)(void *), void *arg) {
+    if (!func || prio < 0 || prio >= THREAD_POOL_NUM_PRIO) {
+        LOGE("Invalid task function or priority %d", prio);
+        return -EINVAL;
+    }
+    struct task task = { .func = func, .arg = arg, .prio = prio };
+    int ret = thread_pool_submit(tp, &task);
+    if (ret == 0) LOGD("Task enqueued with priority %d", prio);
+    return ret;
+}
+
+int thread_pool_get_lane_stats(struct thread_pool *tp, enum thread_pool_prio prio, struct thread_pool_lane_stats *stats) {
+    if (!stats || prio < 0 || prio >= THREAD_POOL_NUM_PRIO) return -EINVAL;
+    struct lane *lane = &tp->lanes[prio];
+    stats->depth = atomic_load_explicit(&lane->depth, memory_order_relaxed);
+    stats->enqueued = atomic_load_explicit(&lane->enqueued, memory_order_relaxed);
+    stats->dequeued = atomic_load_explicit(&lane->dequeued, memory_order_relaxed);
+    stats->rejected = atomic_load_explicit(&lane->rejected, memory_order_relaxed);
+    stats->max_wait_ns = atomic_load_explicit(&lane->wait_ns_max, memory_order_relaxed);
+    uint64_t total = atomic_load_explicit(&lane->wait_ns_total, memory_order_relaxed);
+    stats->avg_wait_ns = stats->dequeued ? total / stats->dequeued : 0;
+    return 0;
+}
+
+int thread_pool_get_stats(struct thread_pool *tp, struct thread_pool_stats *stats) {
+    if (!tp || !stats) return -EINVAL;
+    memset(stats, 0, sizeof(*stats));
+    stats->num_workers = tp->num_threads < THREAD_POOL_MAX_THREADS ? tp->num_threads : THREAD_POOL_MAX_THREADS;
+    stats->live_threads = atomic_load(&tp->live_threads);
+    for (int i = 0; i < stats->num_workers; i++) {
+        struct worker_metrics *m = &tp->workers[i].metrics;
+        struct thread_pool_worker_stats *ws = &stats->workers[i];
+        ws->id = tp->workers[i].id;
+        ws->active = atomic_load_explicit(&tp->workers[i].active, memory_order_relaxed);
+        ws->tasks = atomic_load_explicit(&m->tasks, memory_order_relaxed);
+        ws->busy_ns = atomic_load_explicit(&m->busy_ns, memory_order_relaxed);
+        ws->idle_ns = atomic_load_explicit(&m->idle_ns, memory_order_relaxed);
+        ws->steals = atomic_load_explicit(&m->steals, memory_order_relaxed);
+        for (int b = 0; b < THREAD_POOL_HIST_BUCKETS; b++) {
+            ws->wait_hist[b] = atomic_load_explicit(&m->wait_hist[b], memory_order_relaxed);
+            ws->run_hist[b] = atomic_load_explicit(&m->run_hist[b], memory_order_relaxed);
+            stats->wait_hist[b] += ws->wait_hist[b];
+            stats->run_hist[b] += ws->run_hist[b];
+        }
+    }
+    return 0;
+}
+
+uint64_t thread_pool_hist_percentile_ns(const uint64_t *hist, double p) {
+    uint64_t total = 0;
+    for (int b = 0; b < THREAD_POOL_HIST_BUCKETS; b++) total += hist[b];
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * total + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < THREAD_POOL_HIST_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= rank) return 2ULL << b;
+    }
+    return 2ULL << (THREAD_POOL_HIST_BUCKETS - 1);
+}
+
+int thread_pool_enqueue_affine(struct thread_pool *tp, unsigned int key, void (*func)(void *), void *arg) {
+    if (!func) {
+        LOGE("Invalid task function");
         return -EINVAL;
     }
-    struct task *task = malloc(sizeof(struct task));
-    if (!task) {
-        logger_log(LOG_ERROR, "Failed to allocate task");
+    struct task task = { .func = func, .arg = arg, .prio = THREAD_POOL_PRIO_NORMAL };
+    if (tp->mode != THREAD_POOL_WORK_STEALING) return thread_pool_submit(tp, &task);
+
+    struct worker *target = &tp->workers[key % tp->num_threads];
+    if (!atomic_load(&target->active)) return thread_pool_submit(tp, &task);
+    task.enqueue_ns = thread_pool_now_ns();
+    atomic_fetch_add(&tp->pending, 1);
+    if (task_ring_push(&target->inbox, &task) != 0) {
+        thread_pool_task_finished(tp, 1);
+        LOGD("Inbox of worker %d full, falling back to shared queue", target->id);
+        return thread_pool_submit(tp, &task);
+    }
+    if (!atomic_load(&target->active)) {
+        /* Target retired after our check: it may have drained before our push, so rescue one task */
+        struct task orphan;
+        if (task_ring_pop(&target->inbox, &orphan) == 0) {
+            while (lane_push(&tp->lanes[THREAD_POOL_PRIO_NORMAL], &orphan) != 0) sched_yield();
+            thread_pool_wake_one(tp);
+        }
+        return 0;
+    }
+    if (current_worker_of(tp) != target) thread_pool_wake_worker(tp, target);
+    LOGD("Task enqueued to worker %d", target->id);
+    return 0;
+}
+
+int thread_pool_group_init(thread_pool_group_t **group) {
+    *group = malloc(sizeof(struct thread_pool_group));
+    if (!*group) {
+        LOGE("Failed to allocate task group");
         return -ENOMEM;
     }
-    task->func = func;
-    task->arg = arg;
-    task->next = NULL;
-    pthread_mutex_lock(&tp->mutex);
-    if (!tp->head) {
-        tp->head = task;
-        tp->tail = task;
-    } else {
-        tp->tail->next = task;
-        tp->tail = task;
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&(*group)->mutex, NULL);
+    pthread_cond_init(&(*group)->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+    atomic_init(&(*group)->pending, 0);
+    return 0;
+}
+
+void thread_pool_group_destroy(thread_pool_group_t *group) {
+    if (!group) return;
+    if (atomic_load(&group->pending) != 0) {
+        LOGW("Destroying task group with %d pending tasks", atomic_load(&group->pending));
     }
-    pthread_cond_signal(&tp->cond);
-    pthread_mutex_unlock(&tp->mutex);
-    logger_log(LOG_DEBUG, "Task enqueued");
+    pthread_mutex_destroy(&group->mutex);
+    pthread_cond_destroy(&group->cond);
+    free(group);
+}
+
+int thread_pool_group_enqueue(struct thread_pool *tp, thread_pool_group_t *group, void (*func)(void *), void *arg) {
+    if (!func || !group) {
+        LOGE("Invalid task function or group");
+        return -EINVAL;
+    }
+    struct task task = { .func = func, .arg = arg, .group = group, .prio = THREAD_POOL_PRIO_NORMAL };
+    atomic_fetch_add(&group->pending, 1);
+    int ret = thread_pool_submit(tp, &task);
+    if (ret != 0) thread_pool_group_done(group);
+    return ret;
+}
+
+int thread_pool_group_wait(thread_pool_group_t *group, int timeout_ms) {
+    struct timespec ts;
+    deadline_from_ms(&ts, timeout_ms > 0 ? timeout_ms : 0);
+    pthread_mutex_lock(&group->mutex);
+    while (atomic_load(&group->pending) > 0) {
+        int ret = timeout_ms < 0 ? pthread_cond_wait(&group->cond, &group->mutex)
+                                 : pthread_cond_timedwait(&group->cond, &group->mutex, &ts);
+        if (ret == ETIMEDOUT) {
+            pthread_mutex_unlock(&group->mutex);
+            LOGW("Task group wait timed out with %d pending", atomic_load(&group->pending));
+            return -ETIMEDOUT;
+        }
+        if (ret != 0) {
+            pthread_mutex_unlock(&group->mutex);
+            LOGE("Task group wait failed: %s", strerror(ret));
+            return -ret;
+        }
+    }
+    pthread_mutex_unlock(&group->mutex);
     return 0;
-}
\ No newline at end of file
+}
+
+int thread_pool_enqueue_batch(struct thread_pool *tp, const struct thread_pool_job *jobs, int n) {
+    return thread_pool_enqueue_batch_prio(tp, THREAD_POOL_PRIO_NORMAL, jobs, n);
+}
+
+int thread_pool_enqueue_batch_prio(struct thread_pool *tp, enum thread_pool_prio prio,
+                                   const struct thread_pool_job *jobs, int n) {
+    if (!jobs || n <= 0 || n > THREAD_POOL_QUEUE_SIZE || prio < 0 || prio >= THREAD_POOL_NUM_PRIO) {
+        LOGE("Invalid task batch: n=%d, priority %d", n, prio);
+        return -EINVAL;
+    }
+    struct task tasks[n];
+    uint64_t now = thread_pool_now_ns();
+    for (int i = 0; i < n; i++) {
+        if (!jobs[i].func) {
+            LOGE("Invalid task function in batch at %d", i);
+            return -EINVAL;
+        }
+        tasks[i] = (struct task){ .func = jobs[i].func, .arg = jobs[i].arg,
+                                  .enqueue_ns = now, .prio = prio };
+    }
+    atomic_fetch_add(&tp->pending, n);
+    struct worker *w = current_worker_of(tp);
+    int i = 0;
+    if (tp->mode == THREAD_POOL_WORK_STEALING && w && prio == THREAD_POOL_PRIO_NORMAL) {
+        while (i < n && ws_deque_push(&w->deque, &tasks[i]) == 0) i++;
+    }
+    if (i < n && lane_push_batch(&tp->lanes[prio], &tasks[i], n - i) != 0) {
+        if (i > 0) thread_pool_wake_many(tp, i);
+        thread_pool_task_finished(tp, n - i);
+        atomic_fetch_add_explicit(&tp->lanes[prio].rejected, n - i, memory_order_relaxed);
+        LOGD("Task queue has no room for batch of %d", n - i);
+        return i > 0 ? i : -EAGAIN;
+    }
+    thread_pool_wake_many(tp, n);
+    LOGD("Batch of %d tasks enqueued", n);
+    return n;
+}
+
+int thread_pool_submit_future(struct thread_pool *tp, thread_pool_future_t *fut, void *(*func)(void *), void *arg) {
+    if (!fut || !func) {
+        LOGE("Invalid future or task function");
+        return -EINVAL;
+    }
+    fut->func = func;
+    fut->arg = arg;
+    fut->result = NULL;
+    atomic_init(&fut->state, THREAD_POOL_FUTURE_PENDING);
+    struct task task = { .func = future_run, .arg = fut, .prio = THREAD_POOL_PRIO_NORMAL };
+    return thread_pool_submit(tp, &task);
+}
+
+int thread_pool_future_try_get(thread_pool_future_t *fut, void **result) {
+    if (atomic_load_explicit(&fut->state, memory_order_acquire) != THREAD_POOL_FUTURE_DONE) return -EAGAIN;
+    if (result) *result = fut->result;
+    return 0;
+}
+
+int thread_pool_future_wait(thread_pool_future_t *fut, int timeout_ms, void **result) {
+    struct timespec ts;
+    deadline_from_ms(&ts, timeout_ms > 0 ? timeout_ms : 0);
+    int state = atomic_load_explicit(&fut->state, memory_order_acquire);
+    while (state != THREAD_POOL_FUTURE_DONE) {
+        if (state == THREAD_POOL_FUTURE_PENDING &&
+            !atomic_compare_exchange_strong(&fut->state, &state, THREAD_POOL_FUTURE_WAITING))
+            continue;
+        if (futex_wait(&fut->state, THREAD_POOL_FUTURE_WAITING, timeout_ms < 0 ? NULL : &ts) == -ETIMEDOUT) {
+            LOGW("Future wait timed out");
+            return -ETIMEDOUT;
+        }
+        state = atomic_load_explicit(&fut->state, memory_order_acquire);
+    }
+    if (result) *result = fut->result;
+    return 0;
+}
+
+int thread_pool_wait_idle(struct thread_pool *tp, int timeout_ms) {
+    if (current_worker_of(tp)) {
+        LOGE("thread_pool_wait_idle called from a worker thread");
+        return -EDEADLK;
+    }
+    struct timespec ts;
+    deadline_from_ms(&ts, timeout_ms > 0 ? timeout_ms : 0);
+    int ret = 0;
+    int pending;
+    atomic_fetch_add(&tp->idle_waiters, 1);
+    while ((pending = atomic_load(&tp->pending)) > 0) {
+        if (futex_wait(&tp->pending, pending, timeout_ms < 0 ? NULL : &ts) == -ETIMEDOUT) {
+            LOGW("Thread pool wait idle timed out with %d pending", atomic_load(&tp->pending));
+            ret = -ETIMEDOUT;
+            break;
+        }
+    }
+    atomic_fetch_sub(&tp->idle_waiters, 1);
+    return ret;
+}
@@ -1,10 +1,119 @@
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
+#include <stdatomic.h>
+#include <stdint.h>
+
 struct thread_pool;
+typedef struct thread_pool_group thread_pool_group_t;
+
+enum thread_pool_mode {
+    THREAD_POOL_SHARED_QUEUE,   // All workers pull from one queue
+    THREAD_POOL_WORK_STEALING   // Per-worker Chase-Lev deques, idle workers steal
+};
+
+enum thread_pool_prio {
+    THREAD_POOL_PRIO_CRITICAL,   // Alerts/thresholds: always served first
+    THREAD_POOL_PRIO_NORMAL,
+    THREAD_POOL_PRIO_BACKGROUND, // Logging/formatting; aged so it cannot starve
+    THREAD_POOL_NUM_PRIO
+};
+
+struct thread_pool_lane_stats {
+    int depth;
+    uint64_t enqueued;
+    uint64_t dequeued;
+    uint64_t rejected; // Submissions refused with -EAGAIN because the lane was full
+    uint64_t avg_wait_ns;
+    uint64_t max_wait_ns;
+};
+
+#define THREAD_POOL_MAX_THREADS 64 // Workers covered by thread_pool_get_stats()
+#define THREAD_POOL_HIST_BUCKETS 40 // Bucket i counts durations in [2^i, 2^(i+1)) ns
+
+struct thread_pool_worker_stats {
+    int id;
+    int active;
+    uint64_t tasks;
+    uint64_t busy_ns;
+    uint64_t idle_ns;
+    uint64_t steals;
+    uint64_t wait_hist[THREAD_POOL_HIST_BUCKETS]; // Enqueue to start of run
+    uint64_t run_hist[THREAD_POOL_HIST_BUCKETS];
+};
+
+struct thread_pool_stats {
+    int num_workers;
+    int live_threads;
+    struct thread_pool_worker_stats workers[THREAD_POOL_MAX_THREADS];
+    uint64_t wait_hist[THREAD_POOL_HIST_BUCKETS]; // Sum over all workers
+    uint64_t run_hist[THREAD_POOL_HIST_BUCKETS];
+};
+
+struct thread_pool_attr {
+    enum thread_pool_mode mode;
+    /* Elastic sizing, enabled when max_threads > 0; num_threads is then the initial size */
+    int min_threads;
+    int max_threads;
+    int spawn_wait_us;  // Spawn a worker when queue wait exceeds this (0: default)
+    int retire_idle_ms; // Retire a worker idle this long, down to min_threads (0: default)
+};
+
+struct thread_pool_job {
+    void (*func)(void *);
+    void *arg;
+};
+
+enum {
+    THREAD_POOL_FUTURE_PENDING,
+    THREAD_POOL_FUTURE_WAITING, // Pending, and a waiter is sleeping on state
+    THREAD_POOL_FUTURE_DONE
+};
+
+/* Caller-owned completion handle; must stay valid until the task has run */
+typedef struct thread_pool_future {
+    atomic_int state;
+    void *(*func)(void *);
+    void *arg;
+    void *result;
+} thread_pool_future_t;
 
 int thread_pool_init(struct thread_pool **tp, int num_threads);
+int thread_pool_init_attr(struct thread_pool **tp, int num_threads, const struct thread_pool_attr *attr);
 void thread_pool_destroy(struct thread_pool *tp);
+/*
+ * Lock-free, allocation-free; returns -EAGAIN when the bounded queue is full. That is
+ * logged only at DEBUG, so a saturated pool stays cheap to hit; the caller decides what a
+ * rejection means, and thread_pool_get_lane_stats() counts them.
+ */
 int thread_pool_enqueue(struct thread_pool *tp, void (*func)(void *), void *arg);
+int thread_pool_enqueue_prio(struct thread_pool *tp, enum thread_pool_prio prio, void (*func)(void *), void *arg);
+int thread_pool_get_lane_stats(struct thread_pool *tp, enum thread_pool_prio prio, struct thread_pool_lane_stats *stats);
+/* Work-stealing mode: run on worker (key % num_threads), e.g. key = sensor id */
+int thread_pool_enqueue_affine(struct thread_pool *tp, unsigned int key, void (*func)(void *), void *arg);
+/* Publishes n jobs with one reservation and one wakeup; returns the number enqueued */
+int thread_pool_enqueue_batch(struct thread_pool *tp, const struct thread_pool_job *jobs, int n);
+int thread_pool_enqueue_batch_prio(struct thread_pool *tp, enum thread_pool_prio prio,
+                                   const struct thread_pool_job *jobs, int n);
+int thread_pool_submit_future(struct thread_pool *tp, thread_pool_future_t *fut, void *(*func)(void *), void *arg);
+/* Returns -EAGAIN if the result is not ready yet */
+int thread_pool_future_try_get(thread_pool_future_t *fut, void **result);
+int thread_pool_future_wait(thread_pool_future_t *fut, int timeout_ms, void **result);
+/* Snapshot of per-worker counters; values are monotonic, diff two snapshots for rates */
+int thread_pool_get_stats(struct thread_pool *tp, struct thread_pool_stats *stats);
+/* Upper bound in ns of the bucket holding percentile p (0-100) of hist */
+uint64_t thread_pool_hist_percentile_ns(const uint64_t *hist, double p);
+/* Wait until every enqueued task has finished; must not be called from a worker */
+int thread_pool_wait_idle(struct thread_pool *tp, int timeout_ms);
+
+/* Task groups: tasks run independently; callers that need a batch barrier wait on the group */
+int thread_pool_group_init(thread_pool_group_t **group);
+void thread_pool_group_destroy(thread_pool_group_t *group);
+int thread_pool_group_enqueue(struct thread_pool *tp, thread_pool_group_t *group, void (*func)(void *), void *arg);
+/*
+ * timeout_ms < 0 waits forever; returns -ETIMEDOUT if tasks are still pending. Destroy a
+ * group only after a wait on it returned 0; until then a worker may still be using it.
+ */
+int thread_pool_group_wait(thread_pool_group_t *group, int timeout_ms);
 
-#endif /* THREAD_POOL_H */
\ No newline at end of file
+#endif /* THREAD_POOL_H */
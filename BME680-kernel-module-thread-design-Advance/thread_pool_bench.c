@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include "thread_pool.h"
+#include "sync_util.h"
+#include "logger.h"
+
+/*
+ * Task throughput of thread_pool against the previous mutex+malloc list pool, of the
+ * shared-queue against the work-stealing mode, and per-task latency with and without the
+ * previous per-task rendezvous: ./thread_pool_bench [-n tasks]
+ */
+
+#define BENCH_WORKERS 4
+#define BENCH_MAX_PRODUCERS 16
+#define BENCH_MAX_WORKERS 8
+#define BENCH_TASK_SPINS 20 // Work inside each task
+#define BENCH_FANOUT 32     // Subtasks each fan-out task enqueues from its worker
+#define BENCH_IN_FLIGHT 512 // Fan-out tasks and subtasks outstanding, well under the queue size
+
+/*
+ * Previous implementation: a mutex-protected linked list, one malloc per enqueue and a
+ * pthread_cond_signal to wake a worker, which frees the task after running it. Each task
+ * also waited on a barrier and an event_pair before and after running, but both counted
+ * a party outside the pool that never came, so every task stalled on the 5 s timeouts.
+ * With rendezvous set, the barrier is sized to the workers, the nearest form that
+ * completes: no task runs until every worker holds one. The event_pair is left out.
+ */
+struct legacy_task {
+    void (*func)(void *);
+    void *arg;
+    struct legacy_task *next;
+};
+
+struct legacy_pool {
+    pthread_t threads[BENCH_WORKERS];
+    struct legacy_task *head;
+    struct legacy_task *tail;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int rendezvous;
+    pthread_barrier_t barrier;
+    int shutdown;
+};
+
+static void *legacy_worker(void *arg) {
+    struct legacy_pool *tp = (struct legacy_pool *)arg;
+    for (;;) {
+        pthread_mutex_lock(&tp->mutex);
+        while (!tp->head && !tp->shutdown) pthread_cond_wait(&tp->cond, &tp->mutex);
+        if (tp->shutdown) {
+            pthread_mutex_unlock(&tp->mutex);
+            return NULL;
+        }
+        struct legacy_task *task = tp->head;
+        tp->head = task->next;
+        if (!tp->head) tp->tail = NULL;
+        pthread_mutex_unlock(&tp->mutex);
+        if (tp->rendezvous) pthread_barrier_wait(&tp->barrier);
+        task->func(task->arg);
+        free(task);
+    }
+}
+
+static void legacy_init(struct legacy_pool *tp, int rendezvous) {
+    pthread_mutex_init(&tp->mutex, NULL);
+    pthread_cond_init(&tp->cond, NULL);
+    tp->rendezvous = rendezvous;
+    if (rendezvous) pthread_barrier_init(&tp->barrier, NULL, BENCH_WORKERS);
+    tp->head = tp->tail = NULL;
+    tp->shutdown = 0;
+    for (int i = 0; i < BENCH_WORKERS; i++) pthread_create(&tp->threads[i], NULL, legacy_worker, tp);
+}
+
+static void legacy_destroy(struct legacy_pool *tp) {
+    pthread_mutex_lock(&tp->mutex);
+    tp->shutdown = 1;
+    pthread_cond_broadcast(&tp->cond);
+    pthread_mutex_unlock(&tp->mutex);
+    for (int i = 0; i < BENCH_WORKERS; i++) pthread_join(tp->threads[i], NULL);
+    pthread_mutex_destroy(&tp->mutex);
+    pthread_cond_destroy(&tp->cond);
+    if (tp->rendezvous) pthread_barrier_destroy(&tp->barrier);
+}
+
+static int legacy_enqueue(struct legacy_pool *tp, void (*func)(void *), void *arg) {
+    struct legacy_task *task = malloc(sizeof(struct legacy_task));
+    if (!task) return -ENOMEM;
+    task->func = func;
+    task->arg = arg;
+    task->next = NULL;
+    pthread_mutex_lock(&tp->mutex);
+    if (tp->tail) tp->tail->next = task;
+    else tp->head = task;
+    tp->tail = task;
+    pthread_cond_signal(&tp->cond);
+    pthread_mutex_unlock(&tp->mutex);
+    return 0;
+}
+
+enum bench_pool { BENCH_RING, BENCH_LIST, BENCH_RENDEZVOUS };
+
+static const char *bench_names[] = { "ring", "list", "rendezvous" };
+
+struct bench_arg {
+    enum bench_pool kind;
+    long tasks;
+    long retries; // -EAGAIN from a full ring
+};
+
+static struct thread_pool *ring_pool;
+static struct legacy_pool list_pool;
+static pthread_barrier_t start_barrier;
+static atomic_long done_tasks;
+
+static void bench_task(void *arg) {
+    (void)arg;
+    for (int i = 0; i < BENCH_TASK_SPINS; i++) cpu_relax();
+    atomic_fetch_add_explicit(&done_tasks, 1, memory_order_release);
+}
+
+static void *bench_thread(void *arg) {
+    struct bench_arg *b = (struct bench_arg *)arg;
+    pthread_barrier_wait(&start_barrier);
+    for (long i = 0; i < b->tasks; i++) {
+        if (b->kind == BENCH_LIST) {
+            legacy_enqueue(&list_pool, bench_task, NULL);
+            continue;
+        }
+        while (thread_pool_enqueue(ring_pool, bench_task, NULL) == -EAGAIN) {
+            b->retries++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_run(enum bench_pool kind, int producers, long ops) {
+    pthread_t tids[producers];
+    struct bench_arg args[producers];
+    long per_thread = ops / producers, total = per_thread * producers, retries = 0;
+
+    if (kind == BENCH_RING) thread_pool_init(&ring_pool, BENCH_WORKERS);
+    else legacy_init(&list_pool, 0);
+    atomic_store(&done_tasks, 0);
+    pthread_barrier_init(&start_barrier, NULL, producers + 1);
+    for (int i = 0; i < producers; i++) {
+        args[i] = (struct bench_arg){ .kind = kind, .tasks = per_thread };
+        pthread_create(&tids[i], NULL, bench_thread, &args[i]);
+    }
+    pthread_barrier_wait(&start_barrier);
+    double start = bench_now();
+    for (int i = 0; i < producers; i++) {
+        pthread_join(tids[i], NULL);
+        retries += args[i].retries;
+    }
+    while (atomic_load_explicit(&done_tasks, memory_order_acquire) < total) sched_yield();
+    double elapsed = bench_now() - start;
+    pthread_barrier_destroy(&start_barrier);
+    if (kind == BENCH_RING) thread_pool_destroy(ring_pool);
+    else legacy_destroy(&list_pool);
+    printf("%-4s %2d producers %8.1f ns/task %7.2f M tasks/s", bench_names[kind], producers,
+           elapsed * 1e9 / total, total / elapsed / 1e6);
+    if (kind == BENCH_RING) printf("  full-queue retries %ld", retries);
+    printf("\n");
+}
+
+static const char *mode_names[] = { "shared", "stealing" };
+
+static struct thread_pool *fanout_pool;
+static atomic_long inline_tasks; // Subtasks run in place because the queue was full
+
+static void fanout_task(void *arg) {
+    (void)arg;
+    for (int i = 0; i < BENCH_FANOUT; i++) {
+        if (thread_pool_enqueue(fanout_pool, bench_task, NULL) != 0) {
+            atomic_fetch_add_explicit(&inline_tasks, 1, memory_order_relaxed);
+            bench_task(NULL);
+        }
+    }
+    bench_task(NULL);
+}
+
+/* Tasks that spawn subtasks from inside the pool: the deques keep them local to the spawning worker */
+static void bench_fanout(enum thread_pool_mode mode, int workers, long ops) {
+    struct thread_pool_attr attr = { .mode = mode };
+    struct thread_pool_stats stats;
+    long roots = ops / (BENCH_FANOUT + 1), total = roots * (BENCH_FANOUT + 1), steals = 0;
+
+    thread_pool_init_attr(&fanout_pool, workers, &attr);
+    atomic_store(&done_tasks, 0);
+    atomic_store(&inline_tasks, 0);
+    double start = bench_now();
+    for (long i = 0; i < roots; i++) {
+        /* Leave room for the subtasks, or the shared queue would be full of fan-out tasks */
+        while (i * (BENCH_FANOUT + 1) - atomic_load_explicit(&done_tasks, memory_order_relaxed) > BENCH_IN_FLIGHT)
+            sched_yield();
+        while (thread_pool_enqueue(fanout_pool, fanout_task, NULL) == -EAGAIN) sched_yield();
+    }
+    while (atomic_load_explicit(&done_tasks, memory_order_acquire) < total) sched_yield();
+    double elapsed = bench_now() - start;
+    thread_pool_get_stats(fanout_pool, &stats);
+    for (int i = 0; i < stats.num_workers; i++) steals += stats.workers[i].steals;
+    thread_pool_destroy(fanout_pool);
+    printf("%-8s %d workers %8.1f ns/task %7.2f M tasks/s  steals %ld  run inline %ld\n", mode_names[mode],
+           workers, elapsed * 1e9 / total, total / elapsed / 1e6, steals, atomic_load(&inline_tasks));
+}
+
+static uint64_t *enqueue_ns, *latency_ns;
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void latency_task(void *arg) {
+    long i = (long)(intptr_t)arg;
+    latency_ns[i] = bench_now_ns() - enqueue_ns[i];
+    bench_task(NULL);
+}
+
+static int bench_cmp_ns(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* One producer hands out a burst of one task per worker and waits for it, so nothing queues up */
+static void bench_latency(enum bench_pool kind, long ops) {
+    long total = ops / BENCH_WORKERS * BENCH_WORKERS;
+
+    enqueue_ns = malloc(total * sizeof(uint64_t));
+    latency_ns = malloc(total * sizeof(uint64_t));
+    if (!enqueue_ns || !latency_ns) {
+        fprintf(stderr, "Out of memory for %ld tasks\n", total);
+        exit(1);
+    }
+    if (kind == BENCH_RING) thread_pool_init(&ring_pool, BENCH_WORKERS);
+    else legacy_init(&list_pool, kind == BENCH_RENDEZVOUS);
+    atomic_store(&done_tasks, 0);
+    double start = bench_now();
+    for (long i = 0; i < total; i += BENCH_WORKERS) {
+        for (long j = i; j < i + BENCH_WORKERS; j++) {
+            enqueue_ns[j] = bench_now_ns();
+            if (kind != BENCH_RING) legacy_enqueue(&list_pool, latency_task, (void *)(intptr_t)j);
+            else while (thread_pool_enqueue(ring_pool, latency_task, (void *)(intptr_t)j) == -EAGAIN) sched_yield();
+        }
+        while (atomic_load_explicit(&done_tasks, memory_order_acquire) < i + BENCH_WORKERS) sched_yield();
+    }
+    double elapsed = bench_now() - start;
+    if (kind == BENCH_RING) thread_pool_destroy(ring_pool);
+    else legacy_destroy(&list_pool);
+    qsort(latency_ns, total, sizeof(uint64_t), bench_cmp_ns);
+    printf("%-10s %8.1f ns/task %7.2f M tasks/s  enqueue to start p50 %6.1f us p99 %7.1f us max %8.1f us\n",
+           bench_names[kind], elapsed * 1e9 / total, total / elapsed / 1e6, latency_ns[total / 2] / 1e3,
+           latency_ns[total * 99 / 100] / 1e3, latency_ns[total - 1] / 1e3);
+    free(enqueue_ns);
+    free(latency_ns);
+}
+
+int main(int argc, char *argv[]) {
+    long ops = 1000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            ops = atol(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-n tasks]\n", argv[0]);
+            return 1;
+        }
+    }
+    logger_init("thread_pool_bench.log");
+    logger_set_level(LOG_WARNING);
+
+    printf("%d workers\n", BENCH_WORKERS);
+    for (int producers = 1; producers <= BENCH_MAX_PRODUCERS; producers *= 2) {
+        for (int kind = BENCH_RING; kind <= BENCH_LIST; kind++) bench_run(kind, producers, ops);
+    }
+    printf("fan-out, %d subtasks per task\n", BENCH_FANOUT);
+    for (int workers = 1; workers <= BENCH_MAX_WORKERS; workers *= 2) {
+        bench_fanout(THREAD_POOL_SHARED_QUEUE, workers, ops);
+        bench_fanout(THREAD_POOL_WORK_STEALING, workers, ops);
+    }
+    printf("bursts of %d tasks, one per worker\n", BENCH_WORKERS);
+    for (int kind = BENCH_RING; kind <= BENCH_RENDEZVOUS; kind++) bench_latency(kind, ops / 10);
+
+    logger_destroy();
+    return 0;
+}
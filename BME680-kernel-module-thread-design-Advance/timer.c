@@ -15,7 +15,7 @@ struct timer {
 
 static void timer_cleanup(void *arg) {
     struct timer *t = (struct timer *)arg;
-    logger_log(LOG_INFO, "Timer cleanup: freeing resources");
+    LOGI("Timer cleanup: freeing resources");
     free(t);
 }
 
@@ -32,7 +32,7 @@ static void *timer_task(void *arg) {
         }
         pthread_testcancel();
         t->callback(t->arg);
-        logger_log(LOG_DEBUG, "Timer callback executed");
+        LOGD("Timer callback executed");
         clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
     }
     pthread_cleanup_pop(0);
@@ -42,7 +42,7 @@ static void *timer_task(void *arg) {
 int timer_init(timer_t *timer, long interval_ms, void (*callback)(void *), void *arg) {
     timer = malloc(sizeof(struct timer));
     if (!timer) {
-        logger_log(LOG_ERROR, "Failed to allocate timer");
+        LOGE("Failed to allocate timer");
         return -ENOMEM;
     }
     timer->interval_ms = interval_ms;
@@ -50,11 +50,11 @@ int timer_init(timer_t *timer, long interval_ms, void (*callback)(void *), void
     timer->arg = arg;
     timer->running = 1;
     if (pthread_create(&timer->thread, NULL, timer_task, timer) != 0) {
-        logger_log(LOG_ERROR, "Failed to create timer thread");
+        LOGE("Failed to create timer thread");
         free(timer);
         return -1;
     }
-    logger_log(LOG_INFO, "Timer initialized with interval %ld ms", interval_ms);
+    LOGI("Timer initialized with interval %ld ms", interval_ms);
     return 0;
 }
 
@@ -62,5 +62,5 @@ void timer_destroy(timer_t *timer) {
     timer->running = 0;
     pthread_cancel(timer->thread);
     pthread_join(timer->thread, NULL);
-    logger_log(LOG_INFO, "Timer destroyed");
+    LOGI("Timer destroyed");
 }
\ No newline at end of file